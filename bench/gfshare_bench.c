@@ -0,0 +1,375 @@
+/*
+ * This file is Copyright the libgfshare contributors 2026
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "config.h"
+#include "libgfshare.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Throughput and latency of the library, for every backend this CPU can
+ * run and a sweep of secret sizes and share shapes. Results go to stdout
+ * as JSON, so that runs on different machines or builds can be compared
+ * by a script; progress goes to stderr.
+ */
+
+#define DEFAULT_MAXSIZE (16 * 1024 * 1024)
+#define DEFAULT_MEMLIMIT (1024 * 1024 * 1024)
+#define DEFAULT_MINTIME 200 /* milliseconds */
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_TSC 1
+#endif
+
+static char* progname;
+
+static const char* backends[] = {
+  "gfni-avx512", "avx512bw", "gfni-avx2", "avx2", "ssse3", "scalar", NULL
+};
+
+/* threshold, sharecount */
+static const unsigned int shapes[][2] = {
+  { 2, 3 }, { 3, 5 }, { 8, 16 }, { 128, 255 }, { 0, 0 }
+};
+
+static double mintime = DEFAULT_MINTIME / 1000.0;
+static int first_result = 1;
+
+void
+usage(FILE* stream)
+{
+  fprintf( stream, "\
+Usage: %s [-b backend] [-s maxsize] [-l memlimit] [-t milliseconds]\n\
+  where backend limits the run to one multiply backend (default all).\n\
+  where maxsize is the largest secret to try, e.g. 64K, 16M or 1G.\n\
+  where memlimit skips cases needing more memory than this for the\n\
+  secret and all of its shares (default 1G).\n\
+  where milliseconds is how long to repeat each measurement for.\n\
+\n\
+Secret sizes go up from 32 bytes in steps of 16x, then maxsize itself.\n\
+The results are written to standard output as JSON.\n\
+", progname );
+}
+
+static double
+now( void )
+{
+  struct timespec ts;
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return ts.tv_sec + (ts.tv_nsec / 1e9);
+}
+
+static unsigned long long
+cycles( void )
+{
+#ifdef HAVE_TSC
+  return __builtin_ia32_rdtsc();
+#else
+  return 0;
+#endif
+}
+
+static unsigned long
+parse_size( const char* arg )
+{
+  char* endptr;
+  unsigned long value = strtoul( arg, &endptr, 10 );
+  if( endptr == arg )
+    return 0;
+  switch( *endptr ) {
+  case 'G': case 'g': value *= 1024;
+  /* fall through */
+  case 'M': case 'm': value *= 1024;
+  /* fall through */
+  case 'K': case 'k': value *= 1024; ++endptr;
+  }
+  return (*endptr == 0) ? value : 0;
+}
+
+/* One measured operation, and what it works on */
+typedef struct {
+  gfshare_ctx* ctx;
+  unsigned char* secret;
+  unsigned char** shares;
+  unsigned char* sharenrs;
+  unsigned int sharecount;
+  unsigned int threshold;
+  unsigned int size;
+} bench_case;
+
+typedef int (*bench_func_t)(bench_case*);
+
+static int
+op_encode( bench_case* bc )
+{
+  gfshare_ctx_enc_setsecret( bc->ctx, bc->secret );
+  return gfshare_ctx_enc_getshares( bc->ctx, bc->shares );
+}
+
+static int
+op_decode( bench_case* bc )
+{
+  gfshare_ctx_dec_extract_shares( bc->ctx,
+                                  (const unsigned char* const*)bc->shares,
+                                  bc->secret, bc->size );
+  return 0;
+}
+
+static int
+op_init_free( bench_case* bc )
+{
+  gfshare_ctx* G = gfshare_ctx_init_enc( bc->sharenrs, bc->sharecount,
+                                         bc->threshold, bc->size );
+  if( G == NULL )
+    return 1;
+  gfshare_ctx_free( G );
+  return 0;
+}
+
+static int
+op_rand( bench_case* bc )
+{
+  gfshare_fill_rand( bc->secret, bc->size );
+  return 0;
+}
+
+/* Run 'func' repeatedly, doubling the count until the batch takes at least
+ * 'mintime', and print what the last batch came to
+ */
+static int
+measure( const char* op, const char* backend, bench_func_t func,
+         bench_case* bc )
+{
+  unsigned long iterations = 1, i;
+  unsigned long long c0, c1;
+  double t0, t1;
+
+  if( func( bc ) != 0 ) /* warm up, and fault everything in */
+    return 1;
+  for( ;; ) {
+    t0 = now();
+    c0 = cycles();
+    for( i = 0; i < iterations; ++i )
+      if( func( bc ) != 0 )
+        return 1;
+    c1 = cycles();
+    t1 = now();
+    if( t1 - t0 >= mintime )
+      break;
+    iterations *= 2;
+  }
+
+  fprintf( stdout, "%s    { \"op\": \"%s\", \"backend\": \"%s\", "
+           "\"size\": %u, \"sharecount\": %u, \"threshold\": %u, "
+           "\"iterations\": %lu, \"ns_per_op\": %.1f, \"mb_per_s\": %.2f, ",
+           first_result ? "" : ",\n", op, backend, bc->size,
+           bc->sharecount, bc->threshold, iterations,
+           (t1 - t0) * 1e9 / iterations,
+           (double)bc->size * iterations / (t1 - t0) / 1e6 );
+#ifdef HAVE_TSC
+  fprintf( stdout, "\"cycles_per_byte\": %.3f }",
+           (double)(c1 - c0) / ((double)bc->size * iterations) );
+#else
+  fprintf( stdout, "\"cycles_per_byte\": null }" );
+#endif
+  fflush( stdout );
+  first_result = 0;
+  fprintf( stderr, "%s: %-9s %-12s %10u bytes %3u-of-%-3u %10.2f MB/s\n",
+           progname, op, backend, bc->size, bc->threshold, bc->sharecount,
+           (double)bc->size * iterations / (t1 - t0) / 1e6 );
+  return 0;
+}
+
+/* Encode, decode and init/free for one backend, shape and size */
+static int
+bench_shape( const char* backend, unsigned int threshold,
+             unsigned int sharecount, unsigned int size )
+{
+  bench_case bc;
+  unsigned char sharenrs[255];
+  unsigned int i;
+  int ret = 1;
+
+  bc.sharecount = sharecount;
+  bc.threshold = threshold;
+  bc.size = size;
+  bc.sharenrs = sharenrs;
+  bc.secret = malloc( size );
+  bc.shares = calloc( sharecount, sizeof(unsigned char*) );
+  if( bc.secret == NULL || bc.shares == NULL )
+    goto out;
+  for( i = 0; i < sharecount; ++i ) {
+    sharenrs[i] = i + 1;
+    if( (bc.shares[i] = malloc( size )) == NULL )
+      goto out;
+  }
+  gfshare_fill_rand( bc.secret, size );
+
+  bc.ctx = gfshare_ctx_init_enc( sharenrs, sharecount, threshold, size );
+  if( bc.ctx == NULL )
+    goto out;
+  ret = measure( "encode", backend, op_encode, &bc );
+  gfshare_ctx_free( bc.ctx );
+  if( ret != 0 )
+    goto out;
+
+  /* recombine from the last 'threshold' shares */
+  for( i = 0; i < sharecount - threshold; ++i )
+    sharenrs[i] = 0;
+  bc.ctx = gfshare_ctx_init_dec( sharenrs, sharecount, threshold, size );
+  if( bc.ctx == NULL ) {
+    ret = 1;
+    goto out;
+  }
+  ret = measure( "decode", backend, op_decode, &bc );
+  gfshare_ctx_free( bc.ctx );
+  if( ret != 0 )
+    goto out;
+
+  for( i = 0; i < sharecount; ++i )
+    sharenrs[i] = i + 1;
+  ret = measure( "init_free", backend, op_init_free, &bc );
+
+out:
+  if( ret != 0 )
+    perror( progname );
+  if( bc.shares != NULL )
+    for( i = 0; i < sharecount; ++i )
+      free( bc.shares[i] );
+  free( bc.shares );
+  free( bc.secret );
+  return ret;
+}
+
+static int
+bench_rand( unsigned long maxsize )
+{
+  bench_case bc;
+  unsigned long size;
+  int ret = 0;
+
+  memset( &bc, 0, sizeof(bc) );
+  for( size = 32; size <= maxsize && size <= (1 << 20) && ret == 0;
+       size *= 32 ) {
+    bc.size = size;
+    if( (bc.secret = malloc( size )) == NULL ) {
+      perror( progname );
+      return 1;
+    }
+    ret = measure( "rand", "chacha20", op_rand, &bc );
+    free( bc.secret );
+  }
+  return ret;
+}
+
+int
+main( int argc, char **argv )
+{
+  const char* only = NULL;
+  unsigned long maxsize = DEFAULT_MAXSIZE;
+  unsigned long memlimit = DEFAULT_MEMLIMIT;
+  unsigned long size, next;
+  unsigned int b, s;
+  char* endptr;
+  int optnr, ret = 0;
+
+  progname = argv[0];
+
+  while( (optnr = getopt(argc, argv, "b:s:l:t:h")) != -1 ) {
+    switch( optnr ) {
+    case 'h':
+      usage( stdout );
+      return 0;
+    case 'b':
+      only = optarg;
+      break;
+    case 's':
+      maxsize = parse_size( optarg );
+      if( maxsize < 32 || maxsize > (1UL << 30) ) {
+        fprintf( stderr, "%s: Invalid argument to option -s\n", progname );
+        usage( stderr );
+        return 1;
+      }
+      break;
+    case 'l':
+      memlimit = parse_size( optarg );
+      if( memlimit == 0 ) {
+        fprintf( stderr, "%s: Invalid argument to option -l\n", progname );
+        usage( stderr );
+        return 1;
+      }
+      break;
+    case 't':
+      mintime = strtoul( optarg, &endptr, 10 ) / 1000.0;
+      if( *endptr != 0 || *optarg == 0 ) {
+        fprintf( stderr, "%s: Invalid argument to option -t\n", progname );
+        usage( stderr );
+        return 1;
+      }
+      break;
+    default:
+      usage( stderr );
+      return 1;
+    }
+  }
+
+  fprintf( stdout, "{\n  \"package\": \"%s\",\n  \"default_backend\": \"%s\",\n"
+           "  \"results\": [\n", PACKAGE_STRING, gfshare_backend_name() );
+
+  ret = bench_rand( maxsize );
+  for( b = 0; backends[b] != NULL && ret == 0; ++b ) {
+    if( only != NULL && strcmp( only, backends[b] ) != 0 )
+      continue;
+    if( gfshare_set_backend( backends[b] ) != 0 ) {
+      if( only != NULL ) {
+        fprintf( stderr, "%s: backend %s is not available: %s\n",
+                 progname, only, strerror( errno ) );
+        ret = 1;
+      }
+      continue;
+    }
+    for( s = 0; shapes[s][0] != 0 && ret == 0; ++s ) {
+      for( size = 32; size <= maxsize && ret == 0; size = next ) {
+        next = (size == maxsize) ? maxsize + 1 :
+               (size * 16 > maxsize) ? maxsize : size * 16;
+        if( (shapes[s][1] + 1) * size > memlimit ) {
+          fprintf( stderr, "%s: skipping %u-of-%u at %lu bytes "
+                   "(over the memory limit)\n", progname, shapes[s][0],
+                   shapes[s][1], size );
+          continue;
+        }
+        ret = bench_shape( backends[b], shapes[s][0], shapes[s][1], size );
+      }
+    }
+  }
+  gfshare_set_backend( NULL );
+
+  fprintf( stdout, "\n  ]\n}\n" );
+  return ret;
+}
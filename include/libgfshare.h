@@ -26,36 +26,133 @@
 #ifndef LIBGFSHARE_H
 #define LIBGFSHARE_H
 
+#include <stddef.h>
 
 typedef struct _gfshare_ctx gfshare_ctx;
 
 typedef void (*gfshare_rand_func_t)(unsigned char*, unsigned int);
 
-/* This will, by default, use random(). It's not very good so you should
- * replace it (perhaps with a function which reads from /dev/urandom).
- * If you can't be bothered, be sure to srandom() before you use any
- * of the gfshare_ctx_enc_* functions
+/* This will, by default, use gfshare_fill_rand_chacha() below, so there
+ * is no need to replace it or to srandom() first. You may still point it
+ * at your own source of randomness if you prefer.
  */
 extern gfshare_rand_func_t gfshare_fill_rand;
 
+/* The built-in generator: ChaCha20, seeded from getrandom(2) or
+ * /dev/urandom the first time each thread uses it (and again in the child
+ * after a fork). It is safe to call from several threads at once.
+ */
+void gfshare_fill_rand_chacha(unsigned char* /* buffer */,
+                              unsigned int /* count */);
+
 /* ------------------------------------------------------[ Preparation ]---- */
 
+/* Where contexts get their memory. 'alloc' must return a block of 'size'
+ * bytes aligned to 'align' (a power of two), or NULL; 'free' is given
+ * back the same size. 'data' is passed to both, e.g. to pick an arena.
+ */
+typedef struct {
+  void* (*alloc)(size_t /* size */, size_t /* align */, void* /* data */);
+  void (*free)(void* /* ptr */, size_t /* size */, void* /* data */);
+  void* data;
+} gfshare_allocator;
+
+/* Use 'allocator' (which is copied) for contexts initialised from now
+ * on, or the built-in one if NULL. Each context remembers the allocator
+ * it was made with and frees itself with that. The built-in allocator
+ * maps contexts of 2MiB or more directly, asking for huge pages.
+ * Returns 1 and sets errno to EINVAL if either function is missing.
+ */
+int gfshare_set_allocator(const gfshare_allocator* /* allocator */);
+
+/* Copy out the allocator new contexts currently use, e.g. to put it back
+ * with gfshare_set_allocator() after using another for a while
+ */
+void gfshare_get_allocator(gfshare_allocator* /* allocator */);
+
+/* Fill in 'allocator' to draw from the library's secure pool, for use
+ * with gfshare_set_allocator(). Its blocks are locked into memory (so
+ * they never reach swap), kept out of core dumps where possible, and
+ * fenced by guard pages. A block ends right at the guard page after it
+ * when its size is a multiple of the alignment asked for, and otherwise
+ * within that alignment of it. Freed blocks are wiped and kept for
+ * reuse, so recycling contexts is cheap. Allocation fails if the memory
+ * can't be locked, e.g. because of RLIMIT_MEMLOCK. Returns 1 with errno
+ * set to ENOTSUP on systems without mmap() and mlock().
+ */
+int gfshare_secure_allocator(gfshare_allocator* /* allocator */);
+
+/* Unmap the freed blocks the secure pool is keeping for reuse */
+void gfshare_secure_trim(void);
+
+/* Name the multiply backend new contexts will use, e.g. "avx2" or
+ * "gfni-avx512". The best one the CPU supports is picked when the library
+ * is loaded, unless GFSHARE_BACKEND in the environment names another.
+ */
+const char* gfshare_backend_name(void);
+
+/* Force a particular backend for contexts initialised from now on, or
+ * pass NULL to go back to the best available. Returns 1 and sets errno
+ * to EINVAL if the name is unknown, or ENOTSUP if this CPU can't run it.
+ */
+int gfshare_set_backend(const char* /* name */);
+
 /* Initialise a gfshare context for producing shares */
 gfshare_ctx* gfshare_ctx_init_enc(const unsigned char* /* sharenrs */,
                                   unsigned int /* sharecount */,
                                   unsigned char /* threshold */,
                                   unsigned int /* maxsize */);
 
+/* Initialise a gfshare context for producing shares whose coefficients
+ * are derived on the fly from a random 32-byte key (with ChaCha20)
+ * instead of being stored. The context then only holds a copy of the
+ * secret, or nothing at all if gfshare_ctx_enc_setsecret_nocopy() is used,
+ * and a cache-sized tile of coefficients for each thread it may use,
+ * which it generates them into. Because of that, a keyed encoder must
+ * not extract shares on two threads at once.
+ */
+gfshare_ctx* gfshare_ctx_init_enc_keyed(const unsigned char* /* sharenrs */,
+                                        unsigned int /* sharecount */,
+                                        unsigned char /* threshold */,
+                                        unsigned int /* maxsize */);
+
 /* Initialise a gfshare context for recombining shares */
 gfshare_ctx* gfshare_ctx_init_dec(const unsigned char* /* sharenrs */,
                                   unsigned int /* sharecount */,
                                   unsigned int /* threshold */,
                                   unsigned int /* maxsize */);
 
-/* Set the current processing size */
+/* Set the current processing size, from 1 up to the context's maxsize */
 int gfshare_ctx_setsize(gfshare_ctx* /* ctx */,
                         unsigned int /* size */);
 
+/* Wipe everything the context has been given (secret, coefficients or
+ * shares, and its key) and set its size back to maxsize, leaving it as
+ * it was when initialised.
+ */
+void gfshare_ctx_reset(gfshare_ctx* /* ctx */);
+
+/* Give a context new share numbers, threshold and maxsize, as if it had
+ * been freed and initialised again as the same kind of context, but
+ * keeping its backend, threads, statistics and hook. Its memory is
+ * reused when the new shape fits and otherwise at least doubled, so the
+ * context may move: like realloc(), this returns the context to use from
+ * now on, or NULL with errno set and the old context untouched.
+ */
+gfshare_ctx* gfshare_ctx_reconfigure(gfshare_ctx* /* ctx */,
+                                     const unsigned char* /* sharenrs */,
+                                     unsigned int /* sharecount */,
+                                     unsigned int /* threshold */,
+                                     unsigned int /* maxsize */);
+
+/* Let the context split each operation across up to 'threads' threads,
+ * or one per online CPU if 'threads' is 0. The results are identical to
+ * the single-threaded ones; small sizes are still done on one thread.
+ * Returns 1 with errno set to ENOTSUP if built without thread support.
+ */
+int gfshare_ctx_set_threads(gfshare_ctx* /* ctx */,
+                            unsigned int /* threads */);
+
 /* Free a share context's memory. */
 void gfshare_ctx_free(gfshare_ctx* /* ctx */);
 
@@ -65,6 +162,25 @@ void gfshare_ctx_free(gfshare_ctx* /* ctx */);
 void gfshare_ctx_enc_setsecret(gfshare_ctx* /* ctx */,
                                const unsigned char* /* secret */);
 
+/* As gfshare_ctx_enc_setsecret(), but the encoder reads the secret in
+ * place rather than copying it, so it must stay valid and unchanged until
+ * the shares have been extracted.
+ */
+void gfshare_ctx_enc_setsecret_nocopy(gfshare_ctx* /* ctx */,
+                                      const unsigned char* /* secret */);
+
+/* Copy out, or replace, the 32-byte key from which a keyed encoder
+ * derives its current coefficients. Setting the key saved when a secret
+ * was split (after providing the same secret) lets a share be produced
+ * again later. Anyone holding the key and a share can recover the
+ * secret, so guard it as you would the secret.
+ * Returns 1 with errno set to EINVAL on a context which isn't keyed.
+ */
+int gfshare_ctx_enc_getkey(const gfshare_ctx* /* ctx */,
+                           unsigned char* /* key */);
+int gfshare_ctx_enc_setkey(gfshare_ctx* /* ctx */,
+                           const unsigned char* /* key */);
+
 /* Extract a share from the context. 
  * 'share' must be preallocated and at least 'size' bytes long.
  * 'sharenr' is the index into the 'sharenrs' array of the share you want.
@@ -73,12 +189,45 @@ int gfshare_ctx_enc_getshare(const gfshare_ctx* /* ctx */,
                              unsigned char /* sharenr */,
                              unsigned char* /* share */);
 
+/* Extract every share from the context in one cache-blocked pass.
+ * 'shares' holds 'sharecount' buffers, one per entry in 'sharenrs', each
+ * preallocated and at least 'size' bytes long. This is much cheaper than
+ * calling gfshare_ctx_enc_getshare() for each share once 'size' outgrows
+ * the CPU cache.
+ */
+int gfshare_ctx_enc_getshares(const gfshare_ctx* /* ctx */,
+                              unsigned char* const* /* shares */);
+
+/* Split 'count' secrets of 'length' bytes each, stored back to back in
+ * 'secrets', with one call. 'shares' holds 'sharecount' buffers of
+ * count * length bytes; share n of secret i is written to
+ * shares[n] + i * length. Any size of batch may be given: it is worked
+ * through 'maxsize' bytes at a time. The context's own secret is left
+ * unspecified afterwards.
+ */
+int gfshare_ctx_enc_batch(gfshare_ctx* /* ctx */,
+                          const unsigned char* /* secrets */,
+                          unsigned int /* count */,
+                          unsigned int /* length */,
+                          unsigned char* const* /* shares */);
+
 /* ----------------------------------------------------[ Recombination ]---- */
 
 /* Inform a recombination context of a change in share indexes */
 void gfshare_ctx_dec_newshares(gfshare_ctx* /* ctx */,
                                const unsigned char* /* sharenrs */);
 
+/* Have a recombination context interpolate the shares to the share
+ * numbered 'sharenr' instead of to the secret, so that every
+ * gfshare_ctx_dec_extract*() call but _batch() produces that share. This
+ * regenerates a lost share (or makes a new one) from 'threshold' others
+ * without the secret ever being formed. 0 goes back to the secret.
+ * Returns 1 with errno set to EINVAL if 'ctx' is not a recombination
+ * context.
+ */
+int gfshare_ctx_dec_settarget(gfshare_ctx* /* ctx */,
+                              unsigned char /* sharenr */);
+
 /* Provide a share context with one of the shares.
  * The 'sharenr' is the index into the 'sharenrs' array
  */
@@ -92,5 +241,162 @@ int gfshare_ctx_dec_giveshare(gfshare_ctx* /* ctx */,
 void gfshare_ctx_dec_extract(const gfshare_ctx* /* ctx */,
                              unsigned char* /* secretbuf */);
 
+/* Extract the secret by interpolation of shares held by the caller,
+ * rather than ones given to the context with gfshare_ctx_dec_giveshare().
+ * 'shares' has an entry for each entry of the 'sharenrs' array, pointing
+ * at 'size' bytes of that share (entries for share number 0 may be NULL).
+ * 'size' is not limited by the context's 'maxsize'.
+ * secretbuf must be allocated and at least 'size' bytes long
+ * Each byte of the secret depends only on the same byte of each share, so
+ * part of a large secret is recovered by reading just that range of each
+ * share (with pread(), say) and passing pointers to those ranges.
+ */
+void gfshare_ctx_dec_extract_shares(const gfshare_ctx* /* ctx */,
+                                    const unsigned char* const* /* shares */,
+                                    unsigned char* /* secretbuf */,
+                                    unsigned int /* size */);
+
+/* One secret to recombine with gfshare_ctx_dec_extract_batch(). The
+ * 'sharenrs' and 'shares' arrays have 'sharecount' entries each, like
+ * those given to gfshare_ctx_dec_newshares() and
+ * gfshare_ctx_dec_extract_shares(); 0 marks a share which is not present.
+ */
+typedef struct {
+  const unsigned char* sharenrs;
+  const unsigned char* const* shares;
+  unsigned char* secretbuf;
+  unsigned int size;
+} gfshare_dec_job;
+
+/* Recombine 'count' secrets, each from its own subset of shares, with one
+ * call. The context's own share numbers and shares are not used or
+ * changed, but it keeps the Lagrange weights of recently seen subsets so
+ * that later jobs and batches using them again need not recompute them.
+ * Returns 1 with errno set to EINVAL, before recombining anything, if a
+ * job repeats a share number.
+ */
+int gfshare_ctx_dec_extract_batch(gfshare_ctx* /* ctx */,
+                                  const gfshare_dec_job* /* jobs */,
+                                  unsigned int /* count */);
+
+/* ------------------------------------------------------[ Resharing ]---- */
+
+/* Move 'size' bytes (at most the encoder's 'maxsize') from one share set
+ * to another, e.g. from 3-of-5 to 4-of-7, without the secret being formed
+ * anywhere but in the encoder. 'oldshares' has an entry per share number
+ * of the recombination context 'dec', as for
+ * gfshare_ctx_dec_extract_shares(); 'newshares' has one per share number
+ * of the splitting context 'enc', as for gfshare_ctx_enc_getshares().
+ * Every call draws fresh coefficients, and leaves the encoder's secret and
+ * coefficients wiped. 'dec' is not changed, so it may be shared by threads
+ * resharing different ranges with encoders of their own. Returns 1 with
+ * errno set to EINVAL if the contexts are the wrong way round, 'dec' has
+ * been retargeted with gfshare_ctx_dec_settarget(), or 'size' is out of
+ * range.
+ */
+int gfshare_ctx_reshare(gfshare_ctx* /* enc */,
+                        const gfshare_ctx* /* dec */,
+                        const unsigned char* const* /* oldshares */,
+                        unsigned char* const* /* newshares */,
+                        unsigned int /* size */);
+
+/* -------------------------------------------------------[ Statistics ]---- */
+
+/* The phases a context's time is accounted to. SETSECRET includes the
+ * RAND time spent drawing its coefficients; GETSHARE covers
+ * gfshare_ctx_enc_getshare(), _getshares() and _batch(); LAGRANGE is the
+ * working out of interpolation weights when a decoder's share numbers
+ * or target change; EXTRACT covers every gfshare_ctx_dec_extract*() call.
+ * gfshare_ctx_reshare() counts all of its EXTRACT, SETSECRET, RAND and
+ * GETSHARE time to the encoder.
+ */
+typedef enum {
+  GFSHARE_PHASE_SETSECRET,
+  GFSHARE_PHASE_RAND,
+  GFSHARE_PHASE_GETSHARE,
+  GFSHARE_PHASE_GIVESHARE,
+  GFSHARE_PHASE_LAGRANGE,
+  GFSHARE_PHASE_EXTRACT,
+  GFSHARE_PHASE_COUNT
+} gfshare_phase;
+
+typedef struct {
+  unsigned long long calls;
+  unsigned long long bytes; /* of secret, share or random data handled */
+  unsigned long long ns;
+} gfshare_phase_stats;
+
+typedef struct {
+  gfshare_phase_stats phase[GFSHARE_PHASE_COUNT];
+} gfshare_stats;
+
+/* Called with 'end' 0 as a phase starts and 1 as it finishes */
+typedef void (*gfshare_hook_func_t)(const gfshare_ctx* /* ctx */,
+                                    gfshare_phase /* phase */,
+                                    int /* end */,
+                                    unsigned long long /* bytes */,
+                                    void* /* data */);
+
+/* Copy out, or zero, the counters the context has kept since it was
+ * initialised. They are not updated atomically, so are only exact if
+ * the context is used by one thread at a time. These, and
+ * gfshare_ctx_set_hook(), return 1 with errno set to ENOTSUP unless the
+ * library was configured with --enable-stats.
+ */
+int gfshare_ctx_get_stats(const gfshare_ctx* /* ctx */,
+                          gfshare_stats* /* stats */);
+int gfshare_ctx_reset_stats(gfshare_ctx* /* ctx */);
+
+/* Have 'hook' called around each phase of work on the context, or stop
+ * with NULL. It runs on the calling thread, inside the library call.
+ */
+int gfshare_ctx_set_hook(gfshare_ctx* /* ctx */,
+                         gfshare_hook_func_t /* hook */,
+                         void* /* data */);
+
+/* -------------------------------------------------[ gf(2**16) variant ]---- */
+
+/* Contexts over gf(2**16) rather than gf(2**8), for when more than 255
+ * shares are wanted: share numbers run from 1 to 65535. They work just
+ * like the functions above, but each pair of bytes of a secret is one
+ * field element, so 'maxsize' and every 'size' must be even (EINVAL
+ * otherwise). Repeated share numbers are refused with EINVAL too, by
+ * gfshare16_ctx_dec_newshares() as well as the initialisers. Shares are
+ * the same length as the secret.
+ */
+typedef struct _gfshare16_ctx gfshare16_ctx;
+
+gfshare16_ctx* gfshare16_ctx_init_enc(const unsigned short* /* sharenrs */,
+                                      unsigned int /* sharecount */,
+                                      unsigned int /* threshold */,
+                                      unsigned int /* maxsize */);
+gfshare16_ctx* gfshare16_ctx_init_dec(const unsigned short* /* sharenrs */,
+                                      unsigned int /* sharecount */,
+                                      unsigned int /* threshold */,
+                                      unsigned int /* maxsize */);
+int gfshare16_ctx_setsize(gfshare16_ctx* /* ctx */,
+                          unsigned int /* size */);
+void gfshare16_ctx_free(gfshare16_ctx* /* ctx */);
+
+void gfshare16_ctx_enc_setsecret(gfshare16_ctx* /* ctx */,
+                                 const unsigned char* /* secret */);
+int gfshare16_ctx_enc_getshare(const gfshare16_ctx* /* ctx */,
+                               unsigned int /* sharenr */,
+                               unsigned char* /* share */);
+int gfshare16_ctx_enc_getshares(const gfshare16_ctx* /* ctx */,
+                                unsigned char* const* /* shares */);
+
+int gfshare16_ctx_dec_newshares(gfshare16_ctx* /* ctx */,
+                                const unsigned short* /* sharenrs */);
+int gfshare16_ctx_dec_giveshare(gfshare16_ctx* /* ctx */,
+                                unsigned int /* sharenr */,
+                                const unsigned char* /* share */);
+void gfshare16_ctx_dec_extract(const gfshare16_ctx* /* ctx */,
+                               unsigned char* /* secretbuf */);
+int gfshare16_ctx_dec_extract_shares(const gfshare16_ctx* /* ctx */,
+                                     const unsigned char* const* /* shares */,
+                                     unsigned char* /* secretbuf */,
+                                     unsigned int /* size */);
+
 #endif /* LIBGFSHARE_H */
 
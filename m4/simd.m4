@@ -0,0 +1,76 @@
+# simd.m4 - autoconf macros for SIMD kernel selection
+#
+# Copyright the libgfshare contributors 2026
+#
+# Permission is hereby granted, free of charge, to any person obtaining
+# a copy of this software and associated documentation files (the
+# "Software"), to deal in the Software without restriction, including
+# without limitation the rights to use, copy, modify, merge, publish,
+# distribute, sublicense, and/or sell copies of the Software, and to
+# permit persons to whom the Software is furnished to do so, subject to
+# the following conditions:
+#
+# The above copyright notice and this permission notice shall be
+# included in all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+# EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+# MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+# IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+# ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+# CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+# WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+# SIMD_TARGET_CHECK(NAME, TARGET, BODY)
+# -------------------------------------
+# Check whether the compiler can build a function for TARGET using the
+# x86 intrinsics in BODY, and define HAVE_NAME_TARGET if it can.
+AC_DEFUN([SIMD_TARGET_CHECK],
+[AC_MSG_CHECKING([whether $CC can build $2 kernels])
+AC_COMPILE_IFELSE([AC_LANG_PROGRAM([[
+#include <immintrin.h>
+__attribute__((target("$2"))) static int probe(const void *p)
+{
+$3
+}
+]], [[return probe(0);]])],
+	[AC_MSG_RESULT([yes])
+	 AC_DEFINE([HAVE_$1_TARGET], [1],
+	           [Define if the compiler can build $2 kernels])],
+	[AC_MSG_RESULT([no])])dnl
+])# SIMD_TARGET_CHECK
+
+# SIMD_KERNELS
+# ------------
+# Add configure option to disable the vectorised multiply kernels, and
+# probe for each instruction set the kernels (and the tools' CRC32C) can
+# be built for.
+AC_DEFUN([SIMD_KERNELS],
+[AC_ARG_ENABLE(simd,
+	AS_HELP_STRING([--disable-simd],
+		       [Only build the portable scalar multiply kernels]),
+	[], [enable_simd=yes])
+if test "x$enable_simd" != "xno" -a "x$GCC" = "xyes"; then
+	AC_CHECK_HEADERS([immintrin.h])
+	if test "x$ac_cv_header_immintrin_h" = "xyes"; then
+		SIMD_TARGET_CHECK([SSSE3], [ssse3], [
+  __m128i v = _mm_loadu_si128((const __m128i*)p);
+  return _mm_cvtsi128_si32(_mm_shuffle_epi8(v, v));])
+		SIMD_TARGET_CHECK([AVX2], [avx2], [
+  __m256i v = _mm256_loadu_si256((const __m256i*)p);
+  return _mm256_movemask_epi8(_mm256_shuffle_epi8(v, v));])
+		SIMD_TARGET_CHECK([AVX512BW], [avx512f,avx512bw], [
+  __m512i v = _mm512_maskz_loadu_epi8(1, p);
+  return (int)_mm512_movepi8_mask(_mm512_shuffle_epi8(v, v));])
+		SIMD_TARGET_CHECK([GFNI_AVX2], [avx2,gfni], [
+  __m256i v = _mm256_loadu_si256((const __m256i*)p);
+  return _mm256_movemask_epi8(_mm256_gf2p8affine_epi64_epi8(v, v, 0));])
+		SIMD_TARGET_CHECK([SSE42], [sse4.2], [
+  return (int)_mm_crc32_u64(0, *(const unsigned long long*)p);])
+		SIMD_TARGET_CHECK([GFNI_AVX512], [avx512f,avx512bw,gfni], [
+  __m512i v = _mm512_maskz_loadu_epi8(1, p);
+  return (int)_mm512_movepi8_mask(_mm512_gf2p8affine_epi64_epi8(v, v, 0));])
+	fi
+fi
+])# SIMD_KERNELS
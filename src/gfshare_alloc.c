@@ -0,0 +1,160 @@
+/*
+ * This file is Copyright the libgfshare contributors 2026
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "config.h"
+#include "libgfshare.h"
+#include "gfshare_alloc.h"
+
+#include <errno.h>
+#include <stdlib.h>
+
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+
+/* The built-in allocator maps blocks of at least this much directly, and
+ * asks for them to be backed by huge pages, which saves TLB misses when
+ * the kernels sweep a large context.
+ */
+#if defined(HAVE_MMAP) && defined(HAVE_SYS_MMAN_H) && defined(MAP_ANONYMOUS)
+#define GFSHARE_HUGE_MIN (2 * 1024 * 1024)
+#endif
+
+static void*
+_gfshare_default_alloc( size_t size, size_t align, void* data )
+{
+  void *ptr;
+#ifdef GFSHARE_HUGE_MIN
+  if( size >= GFSHARE_HUGE_MIN ) {
+    size_t length = (size + GFSHARE_HUGE_MIN - 1) & ~(size_t)(GFSHARE_HUGE_MIN - 1);
+#ifdef MAP_HUGETLB
+    /* Reserved huge pages first; there usually aren't any */
+    ptr = mmap( NULL, length, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0 );
+    if( ptr != MAP_FAILED )
+      return ptr;
+#endif
+    ptr = mmap( NULL, length, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+    if( ptr == MAP_FAILED )
+      return NULL;
+#if defined(HAVE_MADVISE) && defined(MADV_HUGEPAGE)
+    (void)madvise( ptr, length, MADV_HUGEPAGE );
+#endif
+    return ptr;
+  }
+#endif
+#ifdef HAVE_POSIX_MEMALIGN
+  {
+    int error = posix_memalign( &ptr, align, size );
+    if( error != 0 ) {
+      errno = error;
+      return NULL;
+    }
+  }
+#else
+  {
+    /* Over-allocate, and keep what malloc() returned just below the block */
+    unsigned char *raw = malloc( size + align + sizeof(void*) );
+    if( raw == NULL )
+      return NULL;
+    ptr = (void*)(((size_t)(raw + sizeof(void*)) + align - 1) &
+                  ~(size_t)(align - 1));
+    ((void**)ptr)[-1] = raw;
+  }
+#endif
+  return ptr;
+}
+
+static void
+_gfshare_default_free( void* ptr, size_t size, void* data )
+{
+#ifdef GFSHARE_HUGE_MIN
+  if( size >= GFSHARE_HUGE_MIN ) {
+    munmap( ptr, (size + GFSHARE_HUGE_MIN - 1) & ~(size_t)(GFSHARE_HUGE_MIN - 1) );
+    return;
+  }
+#endif
+#ifdef HAVE_POSIX_MEMALIGN
+  free( ptr );
+#else
+  free( ((void**)ptr)[-1] );
+#endif
+}
+
+static const gfshare_allocator _gfshare_default_allocator = {
+  _gfshare_default_alloc, _gfshare_default_free, NULL
+};
+
+static gfshare_allocator _gfshare_current_allocator = {
+  _gfshare_default_alloc, _gfshare_default_free, NULL
+};
+
+/* Use 'allocator' for contexts initialised from now on */
+int
+gfshare_set_allocator( const gfshare_allocator* allocator )
+{
+  if( allocator == NULL ) {
+    _gfshare_current_allocator = _gfshare_default_allocator;
+    return 0;
+  }
+  if( allocator->alloc == NULL || allocator->free == NULL ) {
+    errno = EINVAL;
+    return 1;
+  }
+  _gfshare_current_allocator = *allocator;
+  return 0;
+}
+
+/* Copy out the allocator new contexts currently use */
+void
+gfshare_get_allocator( gfshare_allocator* allocator )
+{
+  *allocator = _gfshare_current_allocator;
+}
+
+const gfshare_allocator*
+_gfshare_allocator_get( void )
+{
+  return &_gfshare_current_allocator;
+}
+
+void*
+_gfshare_alloc( const gfshare_allocator* allocator, size_t size )
+{
+  void *ptr;
+  errno = 0;
+  ptr = allocator->alloc( size, GFSHARE_ALIGN, allocator->data );
+  if( ptr == NULL && errno == 0 )
+    errno = ENOMEM;
+  return ptr;
+}
+
+void
+_gfshare_free( const gfshare_allocator* allocator, void* ptr, size_t size )
+{
+  if( ptr != NULL )
+    allocator->free( ptr, size, allocator->data );
+}
@@ -0,0 +1,63 @@
+/*
+ * This file is Copyright the libgfshare contributors 2026
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef GFSHARE_ALLOC_H
+#define GFSHARE_ALLOC_H
+
+#include <stddef.h>
+#include <string.h>
+
+/* Internal to libgfshare: memory for contexts, from the allocator set
+ * with gfshare_set_allocator() or the built-in one. Every block is
+ * aligned to GFSHARE_ALIGN bytes, and must be freed with the allocator
+ * it came from and the size it was asked for.
+ */
+
+#define GFSHARE_ALIGN 64
+#define GFSHARE_ALIGNED(n) \
+  (((size_t)(n) + GFSHARE_ALIGN - 1) & ~(size_t)(GFSHARE_ALIGN - 1))
+
+/* The allocator new contexts should take a copy of */
+const gfshare_allocator* _gfshare_allocator_get(void);
+
+/* NULL, with errno set, on failure */
+void* _gfshare_alloc(const gfshare_allocator* /* allocator */,
+                     size_t /* size */);
+void _gfshare_free(const gfshare_allocator* /* allocator */,
+                   void* /* ptr */,
+                   size_t /* size */);
+
+/* Zero memory that held secrets, in a way the compiler may not drop as a
+ * dead store even when the memory is about to be freed
+ */
+#ifdef HAVE_EXPLICIT_BZERO
+#define _gfshare_wipe(ptr, size) explicit_bzero( (ptr), (size) )
+#else
+static void* (* const volatile _gfshare_wipe_memset)(void*, int, size_t) =
+  memset;
+#define _gfshare_wipe(ptr, size) _gfshare_wipe_memset( (ptr), 0, (size) )
+#endif
+
+#endif /* GFSHARE_ALLOC_H */
@@ -0,0 +1,281 @@
+/*
+ * This file is Copyright the libgfshare contributors 2026
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+
+#include "config.h"
+#include "libgfshare.h"
+#include "gfshare_chacha.h"
+#include "gfshare_alloc.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
+#ifdef HAVE_AVX2_TARGET
+#include <immintrin.h>
+#endif
+
+#define ROTL32(v, n) (((v) << (n)) | ((v) >> (32 - (n))))
+
+#define QUARTERROUND(a, b, c, d) do { \
+    a += b; d ^= a; d = ROTL32(d, 16); \
+    c += d; b ^= c; b = ROTL32(b, 12); \
+    a += b; d ^= a; d = ROTL32(d, 8); \
+    c += d; b ^= c; b = ROTL32(b, 7); \
+  } while (0)
+
+static uint32_t
+_gfshare_load32( const unsigned char *p )
+{
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+         ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void
+_gfshare_store32( unsigned char *p, uint32_t v )
+{
+  p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24;
+}
+
+static void
+_gfshare_chacha20_block( const uint32_t *state, unsigned char *out )
+{
+  uint32_t x[16];
+  unsigned int i;
+  memcpy( x, state, sizeof(x) );
+  for( i = 0; i < 10; ++i ) {
+    QUARTERROUND( x[0], x[4], x[8], x[12] );
+    QUARTERROUND( x[1], x[5], x[9], x[13] );
+    QUARTERROUND( x[2], x[6], x[10], x[14] );
+    QUARTERROUND( x[3], x[7], x[11], x[15] );
+    QUARTERROUND( x[0], x[5], x[10], x[15] );
+    QUARTERROUND( x[1], x[6], x[11], x[12] );
+    QUARTERROUND( x[2], x[7], x[8], x[13] );
+    QUARTERROUND( x[3], x[4], x[9], x[14] );
+  }
+  for( i = 0; i < 16; ++i )
+    _gfshare_store32( out + (4 * i), x[i] + state[i] );
+  /* The working state is keystream, so don't leave it on the stack */
+  _gfshare_wipe( x, sizeof(x) );
+}
+
+
+#ifdef HAVE_AVX2_TARGET
+/* Eight blocks at once, one per 32-bit lane: vector n holds word n of
+ * each block, so the rounds are the scalar ones applied lane-wise.
+ */
+#define VROTL(v, n) _mm256_or_si256( _mm256_slli_epi32( v, n ), \
+                                     _mm256_srli_epi32( v, 32 - (n) ) )
+
+#define VQUARTERROUND(a, b, c, d) do { \
+    a = _mm256_add_epi32( a, b ); d = _mm256_xor_si256( d, a ); \
+    d = _mm256_shuffle_epi8( d, rot16 ); \
+    c = _mm256_add_epi32( c, d ); b = _mm256_xor_si256( b, c ); \
+    b = VROTL( b, 12 ); \
+    a = _mm256_add_epi32( a, b ); d = _mm256_xor_si256( d, a ); \
+    d = _mm256_shuffle_epi8( d, rot8 ); \
+    c = _mm256_add_epi32( c, d ); b = _mm256_xor_si256( b, c ); \
+    b = VROTL( b, 7 ); \
+  } while (0)
+
+/* Turn eight vectors of "word n of blocks 0-7" into "words 0-7 of block n" */
+__attribute__((target("avx2")))
+static void
+_gfshare_chacha20_transpose8( __m256i *v )
+{
+  __m256i t0, t1, t2, t3, t4, t5, t6, t7;
+  __m256i u0, u1, u2, u3, u4, u5, u6, u7;
+  t0 = _mm256_unpacklo_epi32( v[0], v[1] );
+  t1 = _mm256_unpackhi_epi32( v[0], v[1] );
+  t2 = _mm256_unpacklo_epi32( v[2], v[3] );
+  t3 = _mm256_unpackhi_epi32( v[2], v[3] );
+  t4 = _mm256_unpacklo_epi32( v[4], v[5] );
+  t5 = _mm256_unpackhi_epi32( v[4], v[5] );
+  t6 = _mm256_unpacklo_epi32( v[6], v[7] );
+  t7 = _mm256_unpackhi_epi32( v[6], v[7] );
+  u0 = _mm256_unpacklo_epi64( t0, t2 );
+  u1 = _mm256_unpackhi_epi64( t0, t2 );
+  u2 = _mm256_unpacklo_epi64( t1, t3 );
+  u3 = _mm256_unpackhi_epi64( t1, t3 );
+  u4 = _mm256_unpacklo_epi64( t4, t6 );
+  u5 = _mm256_unpackhi_epi64( t4, t6 );
+  u6 = _mm256_unpacklo_epi64( t5, t7 );
+  u7 = _mm256_unpackhi_epi64( t5, t7 );
+  v[0] = _mm256_permute2x128_si256( u0, u4, 0x20 );
+  v[1] = _mm256_permute2x128_si256( u1, u5, 0x20 );
+  v[2] = _mm256_permute2x128_si256( u2, u6, 0x20 );
+  v[3] = _mm256_permute2x128_si256( u3, u7, 0x20 );
+  v[4] = _mm256_permute2x128_si256( u0, u4, 0x31 );
+  v[5] = _mm256_permute2x128_si256( u1, u5, 0x31 );
+  v[6] = _mm256_permute2x128_si256( u2, u6, 0x31 );
+  v[7] = _mm256_permute2x128_si256( u3, u7, 0x31 );
+}
+
+__attribute__((target("avx2")))
+static void
+_gfshare_chacha20_blocks8( const uint32_t *state,
+                           unsigned long long counter,
+                           unsigned char *out )
+{
+  const __m256i rot16 = _mm256_setr_epi8(
+    2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13,
+    2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13 );
+  const __m256i rot8 = _mm256_setr_epi8(
+    3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14,
+    3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14 );
+  __m256i in[16], x[16];
+  unsigned int i;
+
+  for( i = 0; i < 16; ++i )
+    in[i] = _mm256_set1_epi32( (int)state[i] );
+  in[12] = _mm256_setr_epi32(
+    (int)(uint32_t)(counter + 0), (int)(uint32_t)(counter + 1),
+    (int)(uint32_t)(counter + 2), (int)(uint32_t)(counter + 3),
+    (int)(uint32_t)(counter + 4), (int)(uint32_t)(counter + 5),
+    (int)(uint32_t)(counter + 6), (int)(uint32_t)(counter + 7) );
+  in[13] = _mm256_setr_epi32(
+    (int)(uint32_t)((counter + 0) >> 32), (int)(uint32_t)((counter + 1) >> 32),
+    (int)(uint32_t)((counter + 2) >> 32), (int)(uint32_t)((counter + 3) >> 32),
+    (int)(uint32_t)((counter + 4) >> 32), (int)(uint32_t)((counter + 5) >> 32),
+    (int)(uint32_t)((counter + 6) >> 32), (int)(uint32_t)((counter + 7) >> 32) );
+  for( i = 0; i < 16; ++i )
+    x[i] = in[i];
+
+  for( i = 0; i < 10; ++i ) {
+    VQUARTERROUND( x[0], x[4], x[8], x[12] );
+    VQUARTERROUND( x[1], x[5], x[9], x[13] );
+    VQUARTERROUND( x[2], x[6], x[10], x[14] );
+    VQUARTERROUND( x[3], x[7], x[11], x[15] );
+    VQUARTERROUND( x[0], x[5], x[10], x[15] );
+    VQUARTERROUND( x[1], x[6], x[11], x[12] );
+    VQUARTERROUND( x[2], x[7], x[8], x[13] );
+    VQUARTERROUND( x[3], x[4], x[9], x[14] );
+  }
+  for( i = 0; i < 16; ++i )
+    x[i] = _mm256_add_epi32( x[i], in[i] );
+
+  _gfshare_chacha20_transpose8( x );
+  _gfshare_chacha20_transpose8( x + 8 );
+  for( i = 0; i < 8; ++i ) {
+    _mm256_storeu_si256( (__m256i*)(out + (64 * i)), x[i] );
+    _mm256_storeu_si256( (__m256i*)(out + (64 * i) + 32), x[i + 8] );
+  }
+  /* As the scalar path does, leave no key or keystream behind, in memory
+   * or in the vector registers
+   */
+  _gfshare_wipe( in, sizeof(in) );
+  _gfshare_wipe( x, sizeof(x) );
+  _mm256_zeroall();
+}
+
+static int _gfshare_chacha20_avx2 = -1;
+
+static void
+_gfshare_chacha20_select( void )
+{
+  __builtin_cpu_init();
+  _gfshare_chacha20_avx2 = __builtin_cpu_supports( "avx2" );
+}
+
+#ifdef HAVE_PTHREAD_H
+static pthread_once_t _gfshare_chacha20_once = PTHREAD_ONCE_INIT;
+#endif
+
+static int
+_gfshare_chacha20_have_avx2( void )
+{
+#ifdef HAVE_PTHREAD_H
+  pthread_once( &_gfshare_chacha20_once, _gfshare_chacha20_select );
+#else
+  if( _gfshare_chacha20_avx2 < 0 )
+    _gfshare_chacha20_select();
+#endif
+  return _gfshare_chacha20_avx2;
+}
+#endif
+
+void
+_gfshare_chacha20( const unsigned char *key,
+                   unsigned long long nonce,
+                   unsigned long long offset,
+                   unsigned char *out,
+                   unsigned int count )
+{
+  uint32_t state[16];
+  unsigned char block[64];
+  unsigned long long counter = offset / 64;
+  unsigned int skip = offset % 64, i, n;
+
+  state[0] = 0x61707865; /* "expand 32-byte k" */
+  state[1] = 0x3320646e;
+  state[2] = 0x79622d32;
+  state[3] = 0x6b206574;
+  for( i = 0; i < 8; ++i )
+    state[4 + i] = _gfshare_load32( key + (4 * i) );
+  state[14] = (uint32_t)nonce;
+  state[15] = (uint32_t)(nonce >> 32);
+
+#ifdef HAVE_AVX2_TARGET
+  if( count >= 512 && _gfshare_chacha20_have_avx2() ) {
+    if( skip != 0 ) {
+      /* Finish the partial first block so the rest are whole */
+      state[12] = (uint32_t)counter;
+      state[13] = (uint32_t)(counter >> 32);
+      _gfshare_chacha20_block( state, block );
+      n = 64 - skip;
+      memcpy( out, block + skip, n );
+      out += n;
+      count -= n;
+      ++counter;
+      skip = 0;
+    }
+    for( ; count >= 512; out += 512, count -= 512, counter += 8 )
+      _gfshare_chacha20_blocks8( state, counter, out );
+  }
+#endif
+
+  while( count > 0 ) {
+    state[12] = (uint32_t)counter;
+    state[13] = (uint32_t)(counter >> 32);
+    if( skip == 0 && count >= 64 ) {
+      _gfshare_chacha20_block( state, out );
+      n = 64;
+    } else {
+      /* Partial block at either end of the range */
+      _gfshare_chacha20_block( state, block );
+      n = (64 - skip < count) ? 64 - skip : count;
+      memcpy( out, block + skip, n );
+      skip = 0;
+    }
+    out += n;
+    count -= n;
+    ++counter;
+  }
+  _gfshare_wipe( block, sizeof(block) );
+  _gfshare_wipe( state, sizeof(state) );
+}
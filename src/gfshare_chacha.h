@@ -0,0 +1,46 @@
+/*
+ * This file is Copyright the libgfshare contributors 2026
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+
+#ifndef GFSHARE_CHACHA_H
+#define GFSHARE_CHACHA_H
+
+/* Internal to libgfshare: the ChaCha20 stream cipher (the original
+ * variant, with a 64-bit nonce and a 64-bit block counter) used to derive
+ * coefficients for keyed encoders.
+ */
+
+#define GFSHARE_CHACHA_KEYLEN 32
+
+/* Write 'count' bytes of the keystream for 'key' and 'nonce' to 'out',
+ * starting 'offset' bytes into the stream.
+ */
+void _gfshare_chacha20(const unsigned char* /* key */,
+                       unsigned long long /* nonce */,
+                       unsigned long long /* offset */,
+                       unsigned char* /* out */,
+                       unsigned int /* count */);
+
+#endif /* GFSHARE_CHACHA_H */
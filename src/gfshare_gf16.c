@@ -0,0 +1,70 @@
+/*
+ * This file is Copyright the libgfshare contributors 2026
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "config.h"
+#include "gfshare_gf16.h"
+
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
+unsigned short _gfshare_logs16[65536];
+unsigned short _gfshare_exps16[2 * GFSHARE_GF16_ORDER];
+
+static void
+_gfshare_gf16_build( void )
+{
+  unsigned int x = 1, i;
+  for( i = 0; i < GFSHARE_GF16_ORDER; ++i ) {
+    _gfshare_exps16[i] = x;
+    _gfshare_exps16[i + GFSHARE_GF16_ORDER] = x;
+    _gfshare_logs16[x] = i;
+    x <<= 1;
+    if( x & 0x10000 )
+      x ^= 0x1100b; /* Unset the 16th bit and mix in 0x100b */
+  }
+  _gfshare_logs16[0] = 0; /* can't log(0) so just set it neatly to 0 */
+}
+
+#ifdef HAVE_PTHREAD_H
+static pthread_once_t _gfshare_gf16_once = PTHREAD_ONCE_INIT;
+
+void
+_gfshare_gf16_init( void )
+{
+  pthread_once( &_gfshare_gf16_once, _gfshare_gf16_build );
+}
+#else
+static int _gfshare_gf16_built = 0;
+
+void
+_gfshare_gf16_init( void )
+{
+  if( !_gfshare_gf16_built ) {
+    _gfshare_gf16_build();
+    _gfshare_gf16_built = 1;
+  }
+}
+#endif
@@ -0,0 +1,45 @@
+/*
+ * This file is Copyright the libgfshare contributors 2026
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef GFSHARE_GF16_H
+#define GFSHARE_GF16_H
+
+/* Internal to libgfshare: log and exp tables for gf(2**16), generated by
+ * the polynomial x**16 + x**12 + x**3 + x + 1 (0x1100b). As for the
+ * 8-bit tables, logs16[0] is 0 and exps16 repeats once so that the sum of
+ * two logs never needs reducing.
+ */
+
+#define GFSHARE_GF16_ORDER 65535
+
+extern unsigned short _gfshare_logs16[65536];
+extern unsigned short _gfshare_exps16[2 * GFSHARE_GF16_ORDER];
+
+/* Build the tables; cheap to call again once they have been built. They
+ * take 384KiB, so they are only built for programs which use gfshare16.
+ */
+void _gfshare_gf16_init(void);
+
+#endif /* GFSHARE_GF16_H */
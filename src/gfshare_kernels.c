@@ -0,0 +1,785 @@
+/*
+ * This file is Copyright the libgfshare contributors 2026
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "config.h"
+#include "gfshare_kernels.h"
+#ifdef GFSHARE_MULTABLE
+#include "libgfshare_multable.h"
+#else
+#include "libgfshare_tables.h"
+#endif
+#include "gfshare_gf16.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_IMMINTRIN_H
+#include <immintrin.h>
+#endif
+
+/* ---------------------------------------------------------[ Scalar ]---- */
+
+/* One product, for building the other kernels' tables */
+static inline unsigned char
+_gfshare_mul( unsigned char a, unsigned char b )
+{
+#ifdef GFSHARE_MULTABLE
+  return muls[a][b];
+#else
+  return (a && b) ? exps[logs[a] + logs[b]] : 0;
+#endif
+}
+
+#ifdef GFSHARE_MULTABLE
+/* muls[coeff] is the whole "times coeff" row, so each byte costs one load
+ * and no branch (the row maps 0 to 0 without needing a test)
+ */
+static void
+_gfshare_muladd_scalar( unsigned char *dst,
+                        const unsigned char *src,
+                        unsigned char coeff,
+                        unsigned int count )
+{
+  const unsigned char *row = muls[coeff];
+  unsigned int i;
+  if( coeff == 0 )
+    return;
+  for( i = 0; i < count; ++i )
+    dst[i] ^= row[src[i]];
+}
+#else
+static void
+_gfshare_muladd_scalar( unsigned char *dst,
+                        const unsigned char *src,
+                        unsigned char coeff,
+                        unsigned int count )
+{
+  unsigned int i, ilog;
+  if( coeff == 0 )
+    return;
+  ilog = logs[coeff];
+  for( i = 0; i < count; ++i )
+    if( src[i] )
+      dst[i] ^= exps[ilog + logs[src[i]]];
+}
+#endif
+
+static int
+_gfshare_have_scalar( void )
+{
+  return 1;
+}
+
+/* ----------------------------------------------------[ Split nibble ]---- */
+
+/* Multiplication by a constant distributes over xor, so coeff * b is
+ * coeff * (b & 0x0f) ^ coeff * (b & 0xf0). Each half has only sixteen
+ * possible values, which fit in a single byte-shuffle lookup table.
+ */
+#if defined(HAVE_SSSE3_TARGET) || defined(HAVE_AVX2_TARGET) || \
+    defined(HAVE_AVX512BW_TARGET)
+static void
+_gfshare_nibble_tables( unsigned char coeff,
+                        unsigned char *lo,
+                        unsigned char *hi )
+{
+  unsigned int i;
+  for( i = 0; i < 16; ++i ) {
+    lo[i] = _gfshare_mul( coeff, i );
+    hi[i] = _gfshare_mul( coeff, i << 4 );
+  }
+}
+#endif
+
+#ifdef HAVE_SSSE3_TARGET
+__attribute__((target("ssse3")))
+static void
+_gfshare_muladd_ssse3( unsigned char *dst,
+                       const unsigned char *src,
+                       unsigned char coeff,
+                       unsigned int count )
+{
+  unsigned char lo[16], hi[16];
+  __m128i tlo, thi, mask;
+  unsigned int i = 0;
+  if( coeff == 0 )
+    return;
+  _gfshare_nibble_tables( coeff, lo, hi );
+  tlo = _mm_loadu_si128( (const __m128i*)lo );
+  thi = _mm_loadu_si128( (const __m128i*)hi );
+  mask = _mm_set1_epi8( 0x0f );
+  for( ; i + 16 <= count; i += 16 ) {
+    __m128i s = _mm_loadu_si128( (const __m128i*)(src + i) );
+    __m128i d = _mm_loadu_si128( (const __m128i*)(dst + i) );
+    __m128i p = _mm_xor_si128(
+      _mm_shuffle_epi8( tlo, _mm_and_si128( s, mask ) ),
+      _mm_shuffle_epi8( thi, _mm_and_si128( _mm_srli_epi64( s, 4 ), mask ) ) );
+    _mm_storeu_si128( (__m128i*)(dst + i), _mm_xor_si128( d, p ) );
+  }
+  _gfshare_muladd_scalar( dst + i, src + i, coeff, count - i );
+}
+
+static int
+_gfshare_have_ssse3( void )
+{
+  return __builtin_cpu_supports( "ssse3" );
+}
+#endif
+
+#ifdef HAVE_AVX2_TARGET
+__attribute__((target("avx2")))
+static void
+_gfshare_muladd_avx2( unsigned char *dst,
+                      const unsigned char *src,
+                      unsigned char coeff,
+                      unsigned int count )
+{
+  unsigned char lo[16], hi[16];
+  __m256i tlo, thi, mask;
+  unsigned int i = 0;
+  if( coeff == 0 )
+    return;
+  _gfshare_nibble_tables( coeff, lo, hi );
+  tlo = _mm256_broadcastsi128_si256( _mm_loadu_si128( (const __m128i*)lo ) );
+  thi = _mm256_broadcastsi128_si256( _mm_loadu_si128( (const __m128i*)hi ) );
+  mask = _mm256_set1_epi8( 0x0f );
+  for( ; i + 32 <= count; i += 32 ) {
+    __m256i s = _mm256_loadu_si256( (const __m256i*)(src + i) );
+    __m256i d = _mm256_loadu_si256( (const __m256i*)(dst + i) );
+    __m256i p = _mm256_xor_si256(
+      _mm256_shuffle_epi8( tlo, _mm256_and_si256( s, mask ) ),
+      _mm256_shuffle_epi8( thi,
+                           _mm256_and_si256( _mm256_srli_epi64( s, 4 ),
+                                             mask ) ) );
+    _mm256_storeu_si256( (__m256i*)(dst + i), _mm256_xor_si256( d, p ) );
+  }
+  _gfshare_muladd_scalar( dst + i, src + i, coeff, count - i );
+}
+
+static int
+_gfshare_have_avx2( void )
+{
+  return __builtin_cpu_supports( "avx2" );
+}
+#endif
+
+#ifdef HAVE_AVX512BW_TARGET
+__attribute__((target("avx512f,avx512bw")))
+static void
+_gfshare_muladd_avx512bw( unsigned char *dst,
+                          const unsigned char *src,
+                          unsigned char coeff,
+                          unsigned int count )
+{
+  unsigned char lo[16], hi[16];
+  __m512i tlo, thi, mask, s, d, p;
+  unsigned int i = 0;
+  if( coeff == 0 )
+    return;
+  _gfshare_nibble_tables( coeff, lo, hi );
+  tlo = _mm512_broadcast_i32x4( _mm_loadu_si128( (const __m128i*)lo ) );
+  thi = _mm512_broadcast_i32x4( _mm_loadu_si128( (const __m128i*)hi ) );
+  mask = _mm512_set1_epi8( 0x0f );
+  for( ; i + 64 <= count; i += 64 ) {
+    s = _mm512_loadu_si512( src + i );
+    d = _mm512_loadu_si512( dst + i );
+    p = _mm512_xor_si512(
+      _mm512_shuffle_epi8( tlo, _mm512_and_si512( s, mask ) ),
+      _mm512_shuffle_epi8( thi,
+                           _mm512_and_si512( _mm512_srli_epi64( s, 4 ),
+                                             mask ) ) );
+    _mm512_storeu_si512( dst + i, _mm512_xor_si512( d, p ) );
+  }
+  if( i < count ) {
+    /* Mop up the tail with a masked load/store rather than going scalar */
+    __mmask64 tail = (~0ULL) >> (64 - (count - i));
+    s = _mm512_maskz_loadu_epi8( tail, src + i );
+    d = _mm512_maskz_loadu_epi8( tail, dst + i );
+    p = _mm512_xor_si512(
+      _mm512_shuffle_epi8( tlo, _mm512_and_si512( s, mask ) ),
+      _mm512_shuffle_epi8( thi,
+                           _mm512_and_si512( _mm512_srli_epi64( s, 4 ),
+                                             mask ) ) );
+    _mm512_mask_storeu_epi8( dst + i, tail, _mm512_xor_si512( d, p ) );
+  }
+}
+
+static int
+_gfshare_have_avx512bw( void )
+{
+  return __builtin_cpu_supports( "avx512f" ) &&
+         __builtin_cpu_supports( "avx512bw" );
+}
+#endif
+
+/* ------------------------------------------------------------[ GFNI ]---- */
+
+/* GF2P8AFFINEQB multiplies each byte by an 8x8 bit matrix. The hardware
+ * field multiply (GF2P8MULB) is fixed to the 0x11b polynomial, but
+ * multiplying by a constant is linear over gf(2) in any representation,
+ * so we build the matrix for "times coeff" in our 0x11d field directly.
+ */
+#if defined(HAVE_GFNI_AVX2_TARGET) || defined(HAVE_GFNI_AVX512_TARGET)
+#define GFSHARE_HAVE_AFFINE 1
+
+/* Building a matrix costs more than applying it to a short buffer, so
+ * all 256 are built once, when the library is loaded.
+ */
+static long long _gfshare_affine_matrices[256];
+
+static void
+_gfshare_affine_init( void )
+{
+  unsigned long long matrix;
+  unsigned int coeff, bit, row, column;
+  for( coeff = 1; coeff < 256; ++coeff ) {
+    matrix = 0;
+    for( bit = 0; bit < 8; ++bit ) {
+      /* column is coeff * x**bit, i.e. where input bit 'bit' ends up */
+      column = _gfshare_mul( coeff, 1 << bit );
+      /* the instruction wants the row for output bit n in byte 7-n */
+      for( row = 0; row < 8; ++row )
+        if( column & (1 << row) )
+          matrix |= 1ULL << ((8 * (7 - row)) + bit);
+    }
+    _gfshare_affine_matrices[coeff] = (long long)matrix;
+  }
+}
+#endif
+
+#ifdef HAVE_GFNI_AVX2_TARGET
+__attribute__((target("avx2,gfni")))
+static void
+_gfshare_muladd_gfni_avx2( unsigned char *dst,
+                           const unsigned char *src,
+                           unsigned char coeff,
+                           unsigned int count )
+{
+  __m256i matrix;
+  unsigned int i = 0;
+  if( coeff == 0 )
+    return;
+  matrix = _mm256_set1_epi64x( _gfshare_affine_matrices[coeff] );
+  for( ; i + 32 <= count; i += 32 ) {
+    __m256i s = _mm256_loadu_si256( (const __m256i*)(src + i) );
+    __m256i d = _mm256_loadu_si256( (const __m256i*)(dst + i) );
+    _mm256_storeu_si256( (__m256i*)(dst + i),
+      _mm256_xor_si256( d, _mm256_gf2p8affine_epi64_epi8( s, matrix, 0 ) ) );
+  }
+  _gfshare_muladd_scalar( dst + i, src + i, coeff, count - i );
+}
+
+static int
+_gfshare_have_gfni_avx2( void )
+{
+  return __builtin_cpu_supports( "avx2" ) && __builtin_cpu_supports( "gfni" );
+}
+#endif
+
+#ifdef HAVE_GFNI_AVX512_TARGET
+__attribute__((target("avx512f,avx512bw,gfni")))
+static void
+_gfshare_muladd_gfni_avx512( unsigned char *dst,
+                             const unsigned char *src,
+                             unsigned char coeff,
+                             unsigned int count )
+{
+  __m512i matrix, s, d;
+  unsigned int i = 0;
+  if( coeff == 0 )
+    return;
+  matrix = _mm512_set1_epi64( _gfshare_affine_matrices[coeff] );
+  for( ; i + 64 <= count; i += 64 ) {
+    s = _mm512_loadu_si512( src + i );
+    d = _mm512_loadu_si512( dst + i );
+    _mm512_storeu_si512( dst + i,
+      _mm512_xor_si512( d, _mm512_gf2p8affine_epi64_epi8( s, matrix, 0 ) ) );
+  }
+  if( i < count ) {
+    __mmask64 tail = (~0ULL) >> (64 - (count - i));
+    s = _mm512_maskz_loadu_epi8( tail, src + i );
+    d = _mm512_maskz_loadu_epi8( tail, dst + i );
+    _mm512_mask_storeu_epi8( dst + i, tail,
+      _mm512_xor_si512( d, _mm512_gf2p8affine_epi64_epi8( s, matrix, 0 ) ) );
+  }
+}
+
+static int
+_gfshare_have_gfni_avx512( void )
+{
+  return __builtin_cpu_supports( "avx512f" ) &&
+         __builtin_cpu_supports( "avx512bw" ) &&
+         __builtin_cpu_supports( "gfni" );
+}
+#endif
+
+/* ------------------------------------------------------[ gf(2**16) ]---- */
+
+/* Below this many bytes it's cheaper to use the log tables directly than
+ * to build the rows
+ */
+#define GFSHARE_ROWS16_MIN 2048
+
+static void
+_gfshare_muladd16_scalar( unsigned char *dst,
+                          const unsigned char *src,
+                          const gfshare_mul16 *mul,
+                          unsigned int count )
+{
+  unsigned int i, ilog, v, coeff = mul->coeff;
+  if( coeff == 0 )
+    return;
+  ilog = _gfshare_logs16[coeff];
+  if( count >= GFSHARE_ROWS16_MIN ) {
+    /* coeff * v is coeff * (v & 0xff) ^ coeff * (v & 0xff00): build a
+     * 256-entry row for each half and go branch-free, two loads per element
+     */
+    unsigned short lo[256], hi[256];
+    lo[0] = hi[0] = 0;
+    for( v = 1; v < 256; ++v ) {
+      lo[v] = _gfshare_exps16[ilog + _gfshare_logs16[v]];
+      hi[v] = _gfshare_exps16[ilog + _gfshare_logs16[v << 8]];
+    }
+    for( i = 0; i + 1 < count; i += 2 ) {
+      v = lo[src[i]] ^ hi[src[i + 1]];
+      dst[i] ^= v & 0xff;
+      dst[i + 1] ^= v >> 8;
+    }
+    return;
+  }
+  for( i = 0; i + 1 < count; i += 2 ) {
+    v = src[i] | (src[i + 1] << 8);
+    if( v ) {
+      v = _gfshare_exps16[ilog + _gfshare_logs16[v]];
+      dst[i] ^= v & 0xff;
+      dst[i + 1] ^= v >> 8;
+    }
+  }
+}
+
+/* As in gf(2**8), but a 16-bit element has four nibbles and each of their
+ * products has two bytes: tables[2n] and tables[2n+1] hold the low and
+ * high bytes of coeff times each value of nibble n. The vector kernels
+ * below split each run of elements into a vector of low bytes and one of
+ * high bytes, look every nibble up in both, and interleave the results
+ * back.
+ */
+#if defined(HAVE_SSSE3_TARGET) || defined(HAVE_AVX2_TARGET) || \
+    defined(HAVE_AVX512BW_TARGET)
+static void
+_gfshare_nibble_tables16( unsigned short coeff,
+                          unsigned char tables[8][16] )
+{
+  unsigned int n, i, v, ilog = _gfshare_logs16[coeff];
+  for( n = 0; n < 4; ++n ) {
+    tables[2 * n][0] = tables[(2 * n) + 1][0] = 0;
+    for( i = 1; i < 16; ++i ) {
+      v = _gfshare_exps16[ilog + _gfshare_logs16[i << (4 * n)]];
+      tables[2 * n][i] = v & 0xff;
+      tables[(2 * n) + 1][i] = v >> 8;
+    }
+  }
+}
+#endif
+
+#ifdef HAVE_SSSE3_TARGET
+__attribute__((target("ssse3")))
+static void
+_gfshare_muladd16_ssse3( unsigned char *dst,
+                         const unsigned char *src,
+                         const gfshare_mul16 *mul,
+                         unsigned int count )
+{
+  __m128i t[8], mask, low;
+  unsigned int i = 0, n;
+  if( mul->coeff == 0 )
+    return;
+  for( n = 0; n < 8; ++n )
+    t[n] = _mm_loadu_si128( (const __m128i*)mul->tables[n] );
+  mask = _mm_set1_epi8( 0x0f );
+  low = _mm_set1_epi16( 0x00ff );
+  for( ; i + 32 <= count; i += 32 ) {
+    __m128i a = _mm_loadu_si128( (const __m128i*)(src + i) );
+    __m128i b = _mm_loadu_si128( (const __m128i*)(src + i + 16) );
+    __m128i lo = _mm_packus_epi16( _mm_and_si128( a, low ),
+                                   _mm_and_si128( b, low ) );
+    __m128i hi = _mm_packus_epi16( _mm_srli_epi16( a, 8 ),
+                                   _mm_srli_epi16( b, 8 ) );
+    __m128i n0 = _mm_and_si128( lo, mask );
+    __m128i n1 = _mm_and_si128( _mm_srli_epi16( lo, 4 ), mask );
+    __m128i n2 = _mm_and_si128( hi, mask );
+    __m128i n3 = _mm_and_si128( _mm_srli_epi16( hi, 4 ), mask );
+    __m128i plo = _mm_xor_si128(
+      _mm_xor_si128( _mm_shuffle_epi8( t[0], n0 ), _mm_shuffle_epi8( t[2], n1 ) ),
+      _mm_xor_si128( _mm_shuffle_epi8( t[4], n2 ), _mm_shuffle_epi8( t[6], n3 ) ) );
+    __m128i phi = _mm_xor_si128(
+      _mm_xor_si128( _mm_shuffle_epi8( t[1], n0 ), _mm_shuffle_epi8( t[3], n1 ) ),
+      _mm_xor_si128( _mm_shuffle_epi8( t[5], n2 ), _mm_shuffle_epi8( t[7], n3 ) ) );
+    _mm_storeu_si128( (__m128i*)(dst + i),
+      _mm_xor_si128( _mm_loadu_si128( (const __m128i*)(dst + i) ),
+                     _mm_unpacklo_epi8( plo, phi ) ) );
+    _mm_storeu_si128( (__m128i*)(dst + i + 16),
+      _mm_xor_si128( _mm_loadu_si128( (const __m128i*)(dst + i + 16) ),
+                     _mm_unpackhi_epi8( plo, phi ) ) );
+  }
+  _gfshare_muladd16_scalar( dst + i, src + i, mul, count - i );
+}
+#endif
+
+#ifdef HAVE_AVX2_TARGET
+/* The packs and unpacks work within each 128-bit lane, and undo each
+ * other, so the elements come back out in the order they went in.
+ */
+__attribute__((target("avx2")))
+static void
+_gfshare_muladd16_avx2( unsigned char *dst,
+                        const unsigned char *src,
+                        const gfshare_mul16 *mul,
+                        unsigned int count )
+{
+  __m256i t[8], mask, low;
+  unsigned int i = 0, n;
+  if( mul->coeff == 0 )
+    return;
+  for( n = 0; n < 8; ++n )
+    t[n] = _mm256_broadcastsi128_si256(
+      _mm_loadu_si128( (const __m128i*)mul->tables[n] ) );
+  mask = _mm256_set1_epi8( 0x0f );
+  low = _mm256_set1_epi16( 0x00ff );
+  for( ; i + 64 <= count; i += 64 ) {
+    __m256i a = _mm256_loadu_si256( (const __m256i*)(src + i) );
+    __m256i b = _mm256_loadu_si256( (const __m256i*)(src + i + 32) );
+    __m256i lo = _mm256_packus_epi16( _mm256_and_si256( a, low ),
+                                      _mm256_and_si256( b, low ) );
+    __m256i hi = _mm256_packus_epi16( _mm256_srli_epi16( a, 8 ),
+                                      _mm256_srli_epi16( b, 8 ) );
+    __m256i n0 = _mm256_and_si256( lo, mask );
+    __m256i n1 = _mm256_and_si256( _mm256_srli_epi16( lo, 4 ), mask );
+    __m256i n2 = _mm256_and_si256( hi, mask );
+    __m256i n3 = _mm256_and_si256( _mm256_srli_epi16( hi, 4 ), mask );
+    __m256i plo = _mm256_xor_si256(
+      _mm256_xor_si256( _mm256_shuffle_epi8( t[0], n0 ),
+                        _mm256_shuffle_epi8( t[2], n1 ) ),
+      _mm256_xor_si256( _mm256_shuffle_epi8( t[4], n2 ),
+                        _mm256_shuffle_epi8( t[6], n3 ) ) );
+    __m256i phi = _mm256_xor_si256(
+      _mm256_xor_si256( _mm256_shuffle_epi8( t[1], n0 ),
+                        _mm256_shuffle_epi8( t[3], n1 ) ),
+      _mm256_xor_si256( _mm256_shuffle_epi8( t[5], n2 ),
+                        _mm256_shuffle_epi8( t[7], n3 ) ) );
+    _mm256_storeu_si256( (__m256i*)(dst + i),
+      _mm256_xor_si256( _mm256_loadu_si256( (const __m256i*)(dst + i) ),
+                        _mm256_unpacklo_epi8( plo, phi ) ) );
+    _mm256_storeu_si256( (__m256i*)(dst + i + 32),
+      _mm256_xor_si256( _mm256_loadu_si256( (const __m256i*)(dst + i + 32) ),
+                        _mm256_unpackhi_epi8( plo, phi ) ) );
+  }
+  _gfshare_muladd16_scalar( dst + i, src + i, mul, count - i );
+}
+#endif
+
+#ifdef HAVE_AVX512BW_TARGET
+__attribute__((target("avx512f,avx512bw")))
+static void
+_gfshare_muladd16_avx512bw( unsigned char *dst,
+                            const unsigned char *src,
+                            const gfshare_mul16 *mul,
+                            unsigned int count )
+{
+  __m512i t[8], mask, low;
+  unsigned int i = 0, n;
+  if( mul->coeff == 0 )
+    return;
+  for( n = 0; n < 8; ++n )
+    t[n] = _mm512_broadcast_i32x4(
+      _mm_loadu_si128( (const __m128i*)mul->tables[n] ) );
+  mask = _mm512_set1_epi8( 0x0f );
+  low = _mm512_set1_epi16( 0x00ff );
+  for( ; i + 128 <= count; i += 128 ) {
+    __m512i a = _mm512_loadu_si512( src + i );
+    __m512i b = _mm512_loadu_si512( src + i + 64 );
+    __m512i lo = _mm512_packus_epi16( _mm512_and_si512( a, low ),
+                                      _mm512_and_si512( b, low ) );
+    __m512i hi = _mm512_packus_epi16( _mm512_srli_epi16( a, 8 ),
+                                      _mm512_srli_epi16( b, 8 ) );
+    __m512i n0 = _mm512_and_si512( lo, mask );
+    __m512i n1 = _mm512_and_si512( _mm512_srli_epi16( lo, 4 ), mask );
+    __m512i n2 = _mm512_and_si512( hi, mask );
+    __m512i n3 = _mm512_and_si512( _mm512_srli_epi16( hi, 4 ), mask );
+    __m512i plo = _mm512_xor_si512(
+      _mm512_xor_si512( _mm512_shuffle_epi8( t[0], n0 ),
+                        _mm512_shuffle_epi8( t[2], n1 ) ),
+      _mm512_xor_si512( _mm512_shuffle_epi8( t[4], n2 ),
+                        _mm512_shuffle_epi8( t[6], n3 ) ) );
+    __m512i phi = _mm512_xor_si512(
+      _mm512_xor_si512( _mm512_shuffle_epi8( t[1], n0 ),
+                        _mm512_shuffle_epi8( t[3], n1 ) ),
+      _mm512_xor_si512( _mm512_shuffle_epi8( t[5], n2 ),
+                        _mm512_shuffle_epi8( t[7], n3 ) ) );
+    _mm512_storeu_si512( dst + i,
+      _mm512_xor_si512( _mm512_loadu_si512( dst + i ),
+                        _mm512_unpacklo_epi8( plo, phi ) ) );
+    _mm512_storeu_si512( dst + i + 64,
+      _mm512_xor_si512( _mm512_loadu_si512( dst + i + 64 ),
+                        _mm512_unpackhi_epi8( plo, phi ) ) );
+  }
+  _gfshare_muladd16_scalar( dst + i, src + i, mul, count - i );
+}
+#endif
+
+/* GFNI has no 16-bit form, but "times coeff" in gf(2**16) is still linear
+ * over gf(2), so it splits into four 8x8 bit matrices: the low and high
+ * bytes of the product each come from one matrix applied to the low byte
+ * of the element and one applied to the high byte. matrices[2*in + out]
+ * maps input byte 'in' to output byte 'out'. They are built once per
+ * coefficient, by _gfshare_mul16_prepare().
+ */
+#ifdef GFSHARE_HAVE_AFFINE
+/* Transpose an 8x8 bit matrix held one row per byte */
+static unsigned long long
+_gfshare_transpose8( unsigned long long x )
+{
+  unsigned long long t;
+  t = (x ^ (x >> 7)) & 0x00AA00AA00AA00AAULL;
+  x = x ^ t ^ (t << 7);
+  t = (x ^ (x >> 14)) & 0x0000CCCC0000CCCCULL;
+  x = x ^ t ^ (t << 14);
+  t = (x ^ (x >> 28)) & 0x00000000F0F0F0F0ULL;
+  return x ^ t ^ (t << 28);
+}
+
+static void
+_gfshare_affine16( unsigned short coeff, long long matrices[4] )
+{
+  unsigned long long columns[4] = { 0, 0, 0, 0 };
+  unsigned int ilog = _gfshare_logs16[coeff], bit, in, column;
+  for( in = 0; in < 2; ++in ) {
+    for( bit = 0; bit < 8; ++bit ) {
+      /* where input bit (8 * in) + bit ends up */
+      column = _gfshare_exps16[ilog + (8 * in) + bit];
+      columns[2 * in] |= (unsigned long long)(column & 0xff) << (8 * bit);
+      columns[(2 * in) + 1] |= (unsigned long long)(column >> 8) << (8 * bit);
+    }
+  }
+  /* turn the columns into rows, then put the row for output bit n in
+   * byte 7-n as the instruction wants
+   */
+  for( in = 0; in < 4; ++in )
+    matrices[in] =
+      (long long)__builtin_bswap64( _gfshare_transpose8( columns[in] ) );
+}
+#endif
+
+#ifdef HAVE_GFNI_AVX2_TARGET
+__attribute__((target("avx2,gfni")))
+static void
+_gfshare_muladd16_gfni_avx2( unsigned char *dst,
+                             const unsigned char *src,
+                             const gfshare_mul16 *mul,
+                             unsigned int count )
+{
+  __m256i m[4], low;
+  unsigned int i = 0, n;
+  if( mul->coeff == 0 )
+    return;
+  for( n = 0; n < 4; ++n )
+    m[n] = _mm256_set1_epi64x( mul->matrices[n] );
+  low = _mm256_set1_epi16( 0x00ff );
+  for( ; i + 64 <= count; i += 64 ) {
+    __m256i a = _mm256_loadu_si256( (const __m256i*)(src + i) );
+    __m256i b = _mm256_loadu_si256( (const __m256i*)(src + i + 32) );
+    __m256i lo = _mm256_packus_epi16( _mm256_and_si256( a, low ),
+                                      _mm256_and_si256( b, low ) );
+    __m256i hi = _mm256_packus_epi16( _mm256_srli_epi16( a, 8 ),
+                                      _mm256_srli_epi16( b, 8 ) );
+    __m256i plo = _mm256_xor_si256(
+      _mm256_gf2p8affine_epi64_epi8( lo, m[0], 0 ),
+      _mm256_gf2p8affine_epi64_epi8( hi, m[2], 0 ) );
+    __m256i phi = _mm256_xor_si256(
+      _mm256_gf2p8affine_epi64_epi8( lo, m[1], 0 ),
+      _mm256_gf2p8affine_epi64_epi8( hi, m[3], 0 ) );
+    _mm256_storeu_si256( (__m256i*)(dst + i),
+      _mm256_xor_si256( _mm256_loadu_si256( (const __m256i*)(dst + i) ),
+                        _mm256_unpacklo_epi8( plo, phi ) ) );
+    _mm256_storeu_si256( (__m256i*)(dst + i + 32),
+      _mm256_xor_si256( _mm256_loadu_si256( (const __m256i*)(dst + i + 32) ),
+                        _mm256_unpackhi_epi8( plo, phi ) ) );
+  }
+  _gfshare_muladd16_scalar( dst + i, src + i, mul, count - i );
+}
+#endif
+
+#ifdef HAVE_GFNI_AVX512_TARGET
+__attribute__((target("avx512f,avx512bw,gfni")))
+static void
+_gfshare_muladd16_gfni_avx512( unsigned char *dst,
+                               const unsigned char *src,
+                               const gfshare_mul16 *mul,
+                               unsigned int count )
+{
+  __m512i m[4], low;
+  unsigned int i = 0, n;
+  if( mul->coeff == 0 )
+    return;
+  for( n = 0; n < 4; ++n )
+    m[n] = _mm512_set1_epi64( mul->matrices[n] );
+  low = _mm512_set1_epi16( 0x00ff );
+  for( ; i + 128 <= count; i += 128 ) {
+    __m512i a = _mm512_loadu_si512( src + i );
+    __m512i b = _mm512_loadu_si512( src + i + 64 );
+    __m512i lo = _mm512_packus_epi16( _mm512_and_si512( a, low ),
+                                      _mm512_and_si512( b, low ) );
+    __m512i hi = _mm512_packus_epi16( _mm512_srli_epi16( a, 8 ),
+                                      _mm512_srli_epi16( b, 8 ) );
+    __m512i plo = _mm512_xor_si512(
+      _mm512_gf2p8affine_epi64_epi8( lo, m[0], 0 ),
+      _mm512_gf2p8affine_epi64_epi8( hi, m[2], 0 ) );
+    __m512i phi = _mm512_xor_si512(
+      _mm512_gf2p8affine_epi64_epi8( lo, m[1], 0 ),
+      _mm512_gf2p8affine_epi64_epi8( hi, m[3], 0 ) );
+    _mm512_storeu_si512( dst + i,
+      _mm512_xor_si512( _mm512_loadu_si512( dst + i ),
+                        _mm512_unpacklo_epi8( plo, phi ) ) );
+    _mm512_storeu_si512( dst + i + 64,
+      _mm512_xor_si512( _mm512_loadu_si512( dst + i + 64 ),
+                        _mm512_unpackhi_epi8( plo, phi ) ) );
+  }
+  _gfshare_muladd16_scalar( dst + i, src + i, mul, count - i );
+}
+#endif
+
+void
+_gfshare_mul16_prepare( unsigned short coeff, gfshare_mul16 *mul )
+{
+  memset( mul, 0, sizeof(*mul) );
+  mul->coeff = coeff;
+  if( coeff == 0 )
+    return;
+#if defined(HAVE_SSSE3_TARGET) || defined(HAVE_AVX2_TARGET) || \
+    defined(HAVE_AVX512BW_TARGET)
+  _gfshare_nibble_tables16( coeff, mul->tables );
+#endif
+#ifdef GFSHARE_HAVE_AFFINE
+  _gfshare_affine16( coeff, mul->matrices );
+#endif
+}
+
+/* ---------------------------------------------------------[ Dispatch ]---- */
+
+const gfshare_kernel _gfshare_kernels[] = {
+#ifdef HAVE_GFNI_AVX512_TARGET
+  { "gfni-avx512", _gfshare_have_gfni_avx512, _gfshare_muladd_gfni_avx512,
+    _gfshare_muladd16_gfni_avx512 },
+#endif
+#ifdef HAVE_AVX512BW_TARGET
+  { "avx512bw", _gfshare_have_avx512bw, _gfshare_muladd_avx512bw,
+    _gfshare_muladd16_avx512bw },
+#endif
+#ifdef HAVE_GFNI_AVX2_TARGET
+  { "gfni-avx2", _gfshare_have_gfni_avx2, _gfshare_muladd_gfni_avx2,
+    _gfshare_muladd16_gfni_avx2 },
+#endif
+#ifdef HAVE_AVX2_TARGET
+  { "avx2", _gfshare_have_avx2, _gfshare_muladd_avx2,
+    _gfshare_muladd16_avx2 },
+#endif
+#ifdef HAVE_SSSE3_TARGET
+  { "ssse3", _gfshare_have_ssse3, _gfshare_muladd_ssse3,
+    _gfshare_muladd16_ssse3 },
+#endif
+  { "scalar", _gfshare_have_scalar, _gfshare_muladd_scalar,
+    _gfshare_muladd16_scalar },
+  { NULL, NULL, NULL, NULL }
+};
+
+static const gfshare_kernel *_gfshare_active_kernel = NULL;
+
+static void
+_gfshare_cpu_init( void )
+{
+#if defined(HAVE_SSSE3_TARGET) || defined(HAVE_AVX2_TARGET) || \
+    defined(HAVE_AVX512BW_TARGET) || defined(HAVE_GFNI_AVX2_TARGET) || \
+    defined(HAVE_GFNI_AVX512_TARGET)
+  __builtin_cpu_init();
+#endif
+}
+
+const gfshare_kernel*
+_gfshare_kernel_select( void )
+{
+  const gfshare_kernel *kernel;
+  _gfshare_cpu_init();
+  for( kernel = _gfshare_kernels; !kernel->supported(); ++kernel )
+    ; /* the scalar kernel is always supported, so this terminates */
+  return kernel;
+}
+
+const gfshare_kernel*
+_gfshare_kernel_find( const char *name )
+{
+  const gfshare_kernel *kernel;
+  for( kernel = _gfshare_kernels; kernel->name != NULL; ++kernel )
+    if( strcmp( kernel->name, name ) == 0 )
+      return kernel;
+  return NULL;
+}
+
+/* Pick the kernel once, when the library is loaded, so that every context
+ * shares the choice. GFSHARE_BACKEND in the environment can override it.
+ */
+#ifdef __GNUC__
+__attribute__((constructor))
+#endif
+static void
+_gfshare_kernel_init( void )
+{
+  const char *forced = getenv( "GFSHARE_BACKEND" );
+  const gfshare_kernel *kernel = NULL;
+  _gfshare_cpu_init();
+#ifdef GFSHARE_HAVE_AFFINE
+  _gfshare_affine_init();
+#endif
+  if( forced != NULL ) {
+    kernel = _gfshare_kernel_find( forced );
+    if( kernel != NULL && !kernel->supported() )
+      kernel = NULL;
+  }
+  _gfshare_active_kernel = (kernel != NULL) ? kernel : _gfshare_kernel_select();
+}
+
+const gfshare_kernel*
+_gfshare_kernel_active( void )
+{
+  if( _gfshare_active_kernel == NULL )
+    _gfshare_kernel_init();
+  return _gfshare_active_kernel;
+}
+
+void
+_gfshare_kernel_set_active( const gfshare_kernel *kernel )
+{
+  _gfshare_active_kernel = kernel;
+}
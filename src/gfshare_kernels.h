@@ -0,0 +1,86 @@
+/*
+ * This file is Copyright the libgfshare contributors 2026
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef GFSHARE_KERNELS_H
+#define GFSHARE_KERNELS_H
+
+/* Internal to libgfshare: the bulk multiply-accumulate kernels used by
+ * the share evaluation and interpolation loops. The gf(2**16) kernels
+ * need _gfshare_gf16_init() to have been called.
+ */
+
+/* dst[i] ^= coeff * src[i] for 0 <= i < count, in gf(2**8) */
+typedef void (*gfshare_muladd_func_t)(unsigned char* /* dst */,
+                                      const unsigned char* /* src */,
+                                      unsigned char /* coeff */,
+                                      unsigned int /* count */);
+
+/* A gf(2**16) coefficient with the lookup tables and bit matrices the
+ * vector kernels multiply by, which cost more to build than a short run
+ * of elements does to multiply; contexts prepare each weight once, when
+ * they work it out, rather than on every call
+ */
+typedef struct {
+  unsigned short coeff;
+  unsigned char tables[8][16]; /* nibble products, for the shuffle kernels */
+  long long matrices[4]; /* bit matrices, for the GFNI kernels */
+} gfshare_mul16;
+
+void _gfshare_mul16_prepare(unsigned short /* coeff */,
+                            gfshare_mul16* /* mul */);
+
+/* The same in gf(2**16): 'count' bytes of little-endian 16-bit elements,
+ * where 'count' is even, times a prepared coefficient
+ */
+typedef void (*gfshare_muladd16_func_t)(unsigned char* /* dst */,
+                                        const unsigned char* /* src */,
+                                        const gfshare_mul16* /* mul */,
+                                        unsigned int /* count */);
+
+typedef struct {
+  const char *name;
+  int (*supported)(void);
+  gfshare_muladd_func_t muladd;
+  gfshare_muladd16_func_t muladd16;
+} gfshare_kernel;
+
+/* Every kernel compiled into this build, best first. The list always
+ * ends with the portable scalar kernel and is terminated by a NULL name.
+ */
+extern const gfshare_kernel _gfshare_kernels[];
+
+/* The best kernel the running CPU supports */
+const gfshare_kernel* _gfshare_kernel_select(void);
+
+/* Look a kernel up by name; NULL if it was not compiled in */
+const gfshare_kernel* _gfshare_kernel_find(const char* /* name */);
+
+/* The kernel new contexts use: chosen when the library is loaded, or
+ * forced by GFSHARE_BACKEND or _gfshare_kernel_set_active()
+ */
+const gfshare_kernel* _gfshare_kernel_active(void);
+void _gfshare_kernel_set_active(const gfshare_kernel* /* kernel */);
+
+#endif /* GFSHARE_KERNELS_H */
@@ -26,8 +26,11 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 
-/* Construct and write out the tables for the gfshare code */
+/* Construct and write out the tables for the gfshare code. With --mul,
+ * write out the full 256x256 product table instead.
+ */
 
 int
 main(int argc, char** argv)
@@ -35,7 +38,7 @@ main(int argc, char** argv)
   unsigned char logs[256];
   unsigned char exps[255];
   unsigned int x;
-  unsigned int i;
+  unsigned int i, j;
   
   x = 1;
   for( i = 0; i < 255; ++i ) {
@@ -52,6 +55,33 @@ main(int argc, char** argv)
    * exps[logs[i]] == i for 1 <= i <= 255
    */
   
+  if( argc > 1 && strcmp( argv[1], "--mul" ) == 0 ) {
+    /* muls[a][b] == a * b, so that muls[a] is the row for multiplying
+     * by a and needs no test for zero
+     */
+    fprintf(stdout, "\
+/*\n\
+ * This file is autogenerated by gfshare_maketable --mul.\n\
+ */\n\
+\n\
+static const unsigned char muls[256][256] = {\n");
+    for( i = 0; i < 256; ++i ) {
+      fprintf(stdout, "  {");
+      for( j = 0; j < 256; ++j ) {
+        x = (i && j) ? exps[(logs[i] + logs[j]) % 255] : 0;
+        fprintf(stdout, " 0x%02x", x);
+        if( j == 255 )
+          fprintf(stdout, " }");
+        else if( (j % 8) == 7 )
+          fprintf(stdout, ",\n   ");
+        else
+          fprintf(stdout, ",");
+      }
+      fprintf(stdout, (i == 255) ? " };\n" : ",\n");
+    }
+    return 0;
+  }
+
   /* Spew out the tables */
   
   fprintf(stdout, "\
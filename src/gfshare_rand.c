@@ -0,0 +1,200 @@
+/*
+ * This file is Copyright the libgfshare contributors 2026
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+
+#include "config.h"
+#include "libgfshare.h"
+#include "gfshare_chacha.h"
+#include "gfshare_alloc.h"
+
+#include <stdio.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef HAVE_SYS_RANDOM_H
+#include <sys/random.h>
+#endif
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
+/* The built-in random number generator. It is seeded once per thread from
+ * the kernel and then expands that seed with ChaCha20 a buffer at a time,
+ * re-keying from the front of each buffer ("fast key erasure") so that
+ * nothing already handed out can be recovered from the state later.
+ */
+
+/* Keystream generated per refill, and the request size above which we
+ * generate straight into the caller's buffer under a one-time key.
+ */
+#define GFSHARE_RAND_BUFFER 4096
+#define GFSHARE_RAND_DIRECT 1024
+
+typedef struct {
+  unsigned long generation; /* 0 until seeded */
+  unsigned int avail;       /* unread bytes at the end of 'buffer' */
+  unsigned char key[GFSHARE_CHACHA_KEYLEN];
+  unsigned char buffer[GFSHARE_RAND_BUFFER];
+} _gfshare_rand_state;
+
+#ifdef HAVE_THREAD_LOCAL
+static __thread _gfshare_rand_state _gfshare_rand;
+#else
+static _gfshare_rand_state _gfshare_rand;
+#ifdef HAVE_PTHREAD_H
+static pthread_mutex_t _gfshare_rand_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+#endif
+
+/* Bumped in the child after a fork, so that parent and child don't go on
+ * to produce the same stream
+ */
+static volatile unsigned long _gfshare_rand_generation = 1;
+
+#ifdef HAVE_PTHREAD_H
+static pthread_once_t _gfshare_rand_once = PTHREAD_ONCE_INIT;
+
+static void
+_gfshare_rand_forked( void )
+{
+  _gfshare_rand_generation++;
+}
+
+static void
+_gfshare_rand_register( void )
+{
+  pthread_atfork( NULL, NULL, _gfshare_rand_forked );
+}
+#else
+static pid_t _gfshare_rand_pid = 0;
+#endif
+
+static void
+_gfshare_rand_seed( unsigned char *key )
+{
+  FILE *devrandom;
+#ifdef HAVE_GETRANDOM
+  unsigned int got = 0;
+  int saved_errno = errno;
+  while( got < GFSHARE_CHACHA_KEYLEN ) {
+    ssize_t n = getrandom( key + got, GFSHARE_CHACHA_KEYLEN - got, 0 );
+    if( n < 0 ) {
+      if( errno == EINTR )
+        continue;
+      break;
+    }
+    got += n;
+  }
+  errno = saved_errno;
+  if( got == GFSHARE_CHACHA_KEYLEN )
+    return;
+#endif
+  devrandom = fopen( "/dev/urandom", "rb" );
+  if( devrandom != NULL ) {
+    size_t n = fread( key, 1, GFSHARE_CHACHA_KEYLEN, devrandom );
+    fclose( devrandom );
+    if( n == GFSHARE_CHACHA_KEYLEN )
+      return;
+  }
+  /* There is no safe way to carry on without entropy */
+  perror( "libgfshare: unable to seed the random number generator" );
+  abort();
+}
+
+static void
+_gfshare_rand_refill( _gfshare_rand_state *state )
+{
+  _gfshare_chacha20( state->key, 0, 0, state->buffer, GFSHARE_RAND_BUFFER );
+  memcpy( state->key, state->buffer, GFSHARE_CHACHA_KEYLEN );
+  memset( state->buffer, 0, GFSHARE_CHACHA_KEYLEN );
+  state->avail = GFSHARE_RAND_BUFFER - GFSHARE_CHACHA_KEYLEN;
+}
+
+/* Hand out (and wipe) the next 'count' buffered bytes */
+static void
+_gfshare_rand_take( _gfshare_rand_state *state,
+                    unsigned char *out,
+                    unsigned int count )
+{
+  unsigned int n;
+  while( count > 0 ) {
+    if( state->avail == 0 )
+      _gfshare_rand_refill( state );
+    n = (state->avail < count) ? state->avail : count;
+    memcpy( out, state->buffer + GFSHARE_RAND_BUFFER - state->avail, n );
+    memset( state->buffer + GFSHARE_RAND_BUFFER - state->avail, 0, n );
+    state->avail -= n;
+    out += n;
+    count -= n;
+  }
+}
+
+static void
+_gfshare_rand_fill( _gfshare_rand_state *state,
+                    unsigned char *buffer,
+                    unsigned int count )
+{
+  unsigned char key[GFSHARE_CHACHA_KEYLEN];
+
+  if( state->generation != _gfshare_rand_generation ) {
+    _gfshare_rand_seed( state->key );
+    state->avail = 0;
+    state->generation = _gfshare_rand_generation;
+  }
+
+  if( count < GFSHARE_RAND_DIRECT ) {
+    _gfshare_rand_take( state, buffer, count );
+    return;
+  }
+  /* Big requests get their own key, used once and thrown away */
+  _gfshare_rand_take( state, key, sizeof(key) );
+  _gfshare_chacha20( key, 0, 0, buffer, count );
+  _gfshare_wipe( key, sizeof(key) );
+}
+
+void
+gfshare_fill_rand_chacha( unsigned char* buffer,
+                          unsigned int count )
+{
+#ifdef HAVE_PTHREAD_H
+  pthread_once( &_gfshare_rand_once, _gfshare_rand_register );
+#else
+  if( _gfshare_rand_pid != getpid() ) {
+    _gfshare_rand_pid = getpid();
+    _gfshare_rand_generation++;
+  }
+#endif
+#if !defined(HAVE_THREAD_LOCAL) && defined(HAVE_PTHREAD_H)
+  pthread_mutex_lock( &_gfshare_rand_lock );
+#endif
+  _gfshare_rand_fill( &_gfshare_rand, buffer, count );
+#if !defined(HAVE_THREAD_LOCAL) && defined(HAVE_PTHREAD_H)
+  pthread_mutex_unlock( &_gfshare_rand_lock );
+#endif
+}
+
+gfshare_rand_func_t gfshare_fill_rand = gfshare_fill_rand_chacha;
@@ -0,0 +1,222 @@
+/*
+ * This file is Copyright the libgfshare contributors 2026
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "config.h"
+#include "libgfshare.h"
+#include "gfshare_alloc.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
+/* The secure pool. Every block is mapped on its own, locked into memory
+ * so it never reaches swap, left out of core dumps where the system
+ * allows, and surrounded by inaccessible guard pages. Blocks are placed
+ * as close to the guard page after them as their alignment allows, so
+ * overrunning one faults: a block whose size is a multiple of its
+ * alignment (as every context's is) ends right at the guard page, and
+ * any other is followed by fewer than 'align' bytes of slack, which an
+ * overrun can reach without faulting.
+ *
+ * Freed blocks are wiped and kept, up to GFSHARE_SECURE_KEEP bytes, to be
+ * handed out again to a request needing the same number of pages; that
+ * way recycling a context costs a memset rather than mapping, locking
+ * and protecting fresh memory.
+ */
+
+#if defined(HAVE_MMAP) && defined(HAVE_MLOCK) && \
+    defined(HAVE_SYS_MMAN_H) && defined(MAP_ANONYMOUS)
+#define GFSHARE_HAVE_SECURE 1
+
+#define GFSHARE_SECURE_KEEP (64 * 1024 * 1024)
+
+typedef struct _gfshare_secure_block {
+  struct _gfshare_secure_block* next;
+  size_t datalen;
+} _gfshare_secure_block;
+
+/* Kept blocks are linked through their first page */
+static _gfshare_secure_block* _gfshare_secure_kept = NULL;
+static size_t _gfshare_secure_keptlen = 0;
+#ifdef HAVE_PTHREAD_H
+static pthread_mutex_t _gfshare_secure_lock = PTHREAD_MUTEX_INITIALIZER;
+#define SECURE_LOCK() pthread_mutex_lock( &_gfshare_secure_lock )
+#define SECURE_UNLOCK() pthread_mutex_unlock( &_gfshare_secure_lock )
+#else
+#define SECURE_LOCK() do { } while( 0 )
+#define SECURE_UNLOCK() do { } while( 0 )
+#endif
+
+static size_t
+_gfshare_secure_pagesize( void )
+{
+  static size_t pagesize = 0;
+  if( pagesize == 0 ) {
+    long ps = sysconf( _SC_PAGESIZE );
+    pagesize = (ps > 0) ? (size_t)ps : 4096;
+  }
+  return pagesize;
+}
+
+/* The data pages a block of 'size' bytes needs, whatever its alignment
+ * (which is at most GFSHARE_ALIGN)
+ */
+static size_t
+_gfshare_secure_datalen( size_t size )
+{
+  size_t page = _gfshare_secure_pagesize();
+  return (size + GFSHARE_ALIGN - 1 + page - 1) & ~(page - 1);
+}
+
+/* Where in its data pages a block of 'size' bytes goes: as near the end
+ * as 'align' allows, which leaves (-size) % align bytes after it
+ */
+static void*
+_gfshare_secure_place( unsigned char* data, size_t datalen,
+                       size_t size, size_t align )
+{
+  return (void*)((size_t)(data + datalen - size) & ~(align - 1));
+}
+
+static void*
+_gfshare_secure_alloc( size_t size, size_t align, void* unused )
+{
+  size_t page = _gfshare_secure_pagesize();
+  size_t datalen = _gfshare_secure_datalen( size );
+  _gfshare_secure_block **link, *block;
+  unsigned char *base;
+
+  if( align > GFSHARE_ALIGN ) {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  SECURE_LOCK();
+  for( link = &_gfshare_secure_kept; *link != NULL; link = &(*link)->next ) {
+    if( (*link)->datalen == datalen ) {
+      block = *link;
+      *link = block->next;
+      _gfshare_secure_keptlen -= datalen;
+      SECURE_UNLOCK();
+      _gfshare_wipe( block, sizeof(*block) );
+      return _gfshare_secure_place( (unsigned char*)block, datalen,
+                                    size, align );
+    }
+  }
+  SECURE_UNLOCK();
+
+  base = mmap( NULL, datalen + (2 * page), PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+  if( base == MAP_FAILED )
+    return NULL;
+  if( mprotect( base, page, PROT_NONE ) != 0 ||
+      mprotect( base + page + datalen, page, PROT_NONE ) != 0 ||
+      mlock( base + page, datalen ) != 0 ) {
+    int saved_errno = errno;
+    munmap( base, datalen + (2 * page) );
+    errno = saved_errno;
+    return NULL;
+  }
+#if defined(HAVE_MADVISE) && defined(MADV_DONTDUMP)
+  (void)madvise( base + page, datalen, MADV_DONTDUMP );
+#endif
+  return _gfshare_secure_place( base + page, datalen, size, align );
+}
+
+static void
+_gfshare_secure_unmap( unsigned char* data, size_t datalen )
+{
+  size_t page = _gfshare_secure_pagesize();
+  munlock( data, datalen );
+  munmap( data - page, datalen + (2 * page) );
+}
+
+static void
+_gfshare_secure_free( void* ptr, size_t size, void* unused )
+{
+  size_t page = _gfshare_secure_pagesize();
+  /* The block ends within the last data page, whatever its alignment */
+  unsigned char *end = (unsigned char*)
+    (((size_t)ptr + size + page - 1) & ~(page - 1));
+  size_t datalen = _gfshare_secure_datalen( size );
+  _gfshare_secure_block *block;
+
+  /* Whatever the caller has wiped, this wipes all of it again */
+  _gfshare_wipe( end - datalen, datalen );
+  SECURE_LOCK();
+  if( _gfshare_secure_keptlen + datalen <= GFSHARE_SECURE_KEEP ) {
+    block = (_gfshare_secure_block*)(end - datalen);
+    block->datalen = datalen;
+    block->next = _gfshare_secure_kept;
+    _gfshare_secure_kept = block;
+    _gfshare_secure_keptlen += datalen;
+    SECURE_UNLOCK();
+    return;
+  }
+  SECURE_UNLOCK();
+  _gfshare_secure_unmap( end - datalen, datalen );
+}
+#endif /* GFSHARE_HAVE_SECURE */
+
+/* Fill in an allocator which draws from the secure pool */
+int
+gfshare_secure_allocator( gfshare_allocator* allocator )
+{
+#ifdef GFSHARE_HAVE_SECURE
+  allocator->alloc = _gfshare_secure_alloc;
+  allocator->free = _gfshare_secure_free;
+  allocator->data = NULL;
+  return 0;
+#else
+  errno = ENOTSUP;
+  return 1;
+#endif
+}
+
+/* Give the blocks the secure pool is keeping back to the system */
+void
+gfshare_secure_trim( void )
+{
+#ifdef GFSHARE_HAVE_SECURE
+  _gfshare_secure_block *block, *next;
+  SECURE_LOCK();
+  block = _gfshare_secure_kept;
+  _gfshare_secure_kept = NULL;
+  _gfshare_secure_keptlen = 0;
+  SECURE_UNLOCK();
+  for( ; block != NULL; block = next ) {
+    next = block->next;
+    _gfshare_secure_unmap( (unsigned char*)block, block->datalen );
+  }
+#endif
+}
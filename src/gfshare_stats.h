@@ -0,0 +1,89 @@
+/*
+ * This file is Copyright the libgfshare contributors 2026
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef GFSHARE_STATS_H
+#define GFSHARE_STATS_H
+
+/* Internal to libgfshare: the per-context statistics kept when configured
+ * with --enable-stats. Without it, GFSHARE_PHASE_BEGIN and _END expand to
+ * nothing and contexts carry no statistics at all.
+ */
+
+#ifdef GFSHARE_STATS
+
+#include <time.h>
+
+typedef struct {
+  gfshare_stats stats;
+  gfshare_hook_func_t hook;
+  void* hookdata;
+} _gfshare_stats_block;
+
+static inline unsigned long long
+_gfshare_stats_now( void )
+{
+  struct timespec ts;
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return (ts.tv_sec * 1000000000ULL) + ts.tv_nsec;
+}
+
+static inline unsigned long long
+_gfshare_phase_begin( const gfshare_ctx* ctx, _gfshare_stats_block* block,
+                      gfshare_phase phase, unsigned long long bytes )
+{
+  if( block->hook != NULL )
+    block->hook( ctx, phase, 0, bytes, block->hookdata );
+  return _gfshare_stats_now();
+}
+
+static inline void
+_gfshare_phase_end( const gfshare_ctx* ctx, _gfshare_stats_block* block,
+                    gfshare_phase phase, unsigned long long bytes,
+                    unsigned long long start )
+{
+  gfshare_phase_stats *stats = &block->stats.phase[phase];
+  stats->ns += _gfshare_stats_now() - start;
+  stats->calls++;
+  stats->bytes += bytes;
+  if( block->hook != NULL )
+    block->hook( ctx, phase, 1, bytes, block->hookdata );
+}
+
+/* Bracket one phase of work on 'ctx', which must have a 'stats' block */
+#define GFSHARE_PHASE_BEGIN(ctx, phase, bytes) \
+  unsigned long long _gfshare_start_##phase = \
+    _gfshare_phase_begin( (ctx), (ctx)->stats, (phase), (bytes) )
+#define GFSHARE_PHASE_END(ctx, phase, bytes) \
+  _gfshare_phase_end( (ctx), (ctx)->stats, (phase), (bytes), \
+                      _gfshare_start_##phase )
+
+#else
+
+#define GFSHARE_PHASE_BEGIN(ctx, phase, bytes) do { } while( 0 )
+#define GFSHARE_PHASE_END(ctx, phase, bytes) do { } while( 0 )
+
+#endif /* GFSHARE_STATS */
+
+#endif /* GFSHARE_STATS_H */
@@ -26,107 +26,359 @@
 #include "config.h"
 #include "libgfshare.h"
 #include "libgfshare_tables.h"
+#include "gfshare_kernels.h"
+#include "gfshare_chacha.h"
+#include "gfshare_stats.h"
+#include "gfshare_alloc.h"
 
 #include <stdio.h>
 #include <errno.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
-#define XMALLOC malloc
-#define XFREE free
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
+#ifndef MIN
+#define MIN(a,b) (((a)<(b))?(a):(b))
+#endif
+
+/* gfshare_ctx_enc_getshares() keeps one tile of every coefficient row
+ * resident while it evaluates the shares; this is how much cache those
+ * tiles may use between them, and the smallest tile worth the overhead.
+ */
+#define GFSHARE_TILE_BUDGET (128 * 1024)
+#define GFSHARE_TILE_MIN 1024
+
+/* Contexts with threads enabled only hand each worker at least this many
+ * bytes; below that, starting the thread costs more than it saves.
+ */
+#define GFSHARE_THREAD_MIN (256 * 1024)
+#define GFSHARE_MAX_THREADS 256
+
+/* gfshare_ctx_dec_extract_batch() remembers the Lagrange weights of recent
+ * share subsets in a small set-associative cache, evicting the least
+ * recently used subset of a set.
+ */
+#define GFSHARE_WEIGHT_SETS 16
+#define GFSHARE_WEIGHT_WAYS 4
+#define GFSHARE_WEIGHT_ENTRIES (GFSHARE_WEIGHT_SETS * GFSHARE_WEIGHT_WAYS)
 
 struct _gfshare_ctx {
   unsigned int sharecount;
   unsigned int threshold;
   unsigned int maxsize;
   unsigned int size;
+  unsigned int threads;
   unsigned char* sharenrs;
   unsigned char* buffer;
+  size_t stride; /* between rows of 'buffer': maxsize, to a cache line */
+  const unsigned char* secret; /* encoding only: the constant term */
+  int keyed; /* encoding only: coefficients come from 'key', not 'buffer' */
+  unsigned char key[GFSHARE_CHACHA_KEYLEN];
+  unsigned char* scratch; /* keyed only: coefficient tiles, per worker */
+  size_t scratchsize; /* of each worker's part of 'scratch' */
+  unsigned char* lagrange; /* decoding only: L(i) per share, 0 if unused */
+  unsigned char target; /* decoding only: the x 'lagrange' interpolates to */
+  unsigned char* weightcache; /* decoding only: share numbers then weights */
+  unsigned int* weightstamps; /* per cache entry, last use; 0 if empty */
+  unsigned int weightclock;
+  const gfshare_kernel* kernel;
+#ifdef GFSHARE_STATS
+  _gfshare_stats_block* stats;
+#endif
+  gfshare_allocator allocator; /* which this block came from */
+  size_t blocksize;
 };
 
+/* ------------------------------------------------------[ Preparation ]---- */
+
+/* Name the multiply backend new contexts will use */
+const char*
+gfshare_backend_name( void )
+{
+  return _gfshare_kernel_active()->name;
+}
+
+/* Force a particular multiply backend for contexts initialised from now on */
+int
+gfshare_set_backend( const char* name )
+{
+  const gfshare_kernel *kernel;
+  if( name == NULL ) {
+    _gfshare_kernel_set_active( _gfshare_kernel_select() );
+    return 0;
+  }
+  kernel = _gfshare_kernel_find( name );
+  if( kernel == NULL ) {
+    errno = EINVAL;
+    return 1;
+  }
+  _gfshare_kernel_active(); /* ensure the CPU has been probed */
+  if( !kernel->supported() ) {
+    errno = ENOTSUP;
+    return 1;
+  }
+  _gfshare_kernel_set_active( kernel );
+  return 0;
+}
+
+/* Each context is a single block from the allocator: the context itself,
+ * then its share numbers, its Lagrange weights if it is a decoder, 'rows'
+ * rows of buffer, each starting on a cache line, and for keyed encoders
+ * the scratch their workers generate coefficient tiles into. The block
+ * may be bigger than the current shape needs if the context has been
+ * reconfigured; see gfshare_ctx_reconfigure().
+ */
+typedef struct {
+  size_t nrs;
+  size_t lagrange;
+  size_t buffer;
+  size_t scratch;
+  size_t scratchsize; /* per worker */
+  size_t end;
+} _gfshare_layout;
+
+/* The tile _gfshare_ctx_enc_range() works in for a given threshold */
+static unsigned int
+_gfshare_tile( unsigned int threshold )
+{
+  unsigned int tile = GFSHARE_TILE_BUDGET / threshold;
+  return (tile < GFSHARE_TILE_MIN) ? GFSHARE_TILE_MIN : (tile & ~63u);
+}
+
+/* The most workers _gfshare_ctx_parallel() can ever give an operation on
+ * a context, however many threads it is later allowed: each gets at
+ * least GFSHARE_THREAD_MIN bytes, and no operation is bigger than maxsize.
+ */
+static unsigned int
+_gfshare_max_workers( unsigned int maxsize )
+{
+#ifdef HAVE_PTHREAD_H
+  unsigned int workers = MIN(maxsize / GFSHARE_THREAD_MIN,
+                             GFSHARE_MAX_THREADS);
+  return (workers < 1) ? 1 : workers;
+#else
+  (void)maxsize;
+  return 1;
+#endif
+}
+
+static size_t
+_gfshare_stats_offset( void )
+{
+  return GFSHARE_ALIGNED(sizeof(struct _gfshare_ctx));
+}
+
 static void
-_gfshare_fill_rand_using_random( unsigned char* buffer,
-                                 unsigned int count )
+_gfshare_ctx_layout( _gfshare_layout* layout,
+                     unsigned int sharecount,
+                     unsigned int threshold,
+                     unsigned int maxsize,
+                     unsigned int rows,
+                     int keyed,
+                     int decoding )
 {
-  unsigned int i;
-  for( i = 0; i < count; ++i )
-    buffer[i] = (random() & 0xff00) >> 8; /* apparently the bottom 8 aren't
-                                           * very random but the middles ones
-                                           * are
-                                           */
+  size_t offset = _gfshare_stats_offset();
+#ifdef GFSHARE_STATS
+  offset += GFSHARE_ALIGNED(sizeof(_gfshare_stats_block));
+#endif
+  layout->nrs = offset;
+  offset += GFSHARE_ALIGNED(sharecount);
+  layout->lagrange = 0;
+  if( decoding ) {
+    layout->lagrange = offset;
+    offset += GFSHARE_ALIGNED(sharecount);
+  }
+  layout->buffer = offset;
+  offset += rows * GFSHARE_ALIGNED(maxsize);
+  /* A keyed encoder's worker needs threshold-1 rows of a tile, and tiles
+   * never run past maxsize
+   */
+  layout->scratch = 0;
+  layout->scratchsize = 0;
+  if( keyed && threshold > 1 ) {
+    layout->scratch = offset;
+    layout->scratchsize = (threshold-1) *
+      (size_t)MIN(_gfshare_tile( threshold ), GFSHARE_ALIGNED(maxsize));
+    offset += _gfshare_max_workers( maxsize ) * layout->scratchsize;
+  }
+  layout->end = offset;
 }
 
-gfshare_rand_func_t gfshare_fill_rand = _gfshare_fill_rand_using_random;
+/* How many rows of buffer a context needs: encoders keep their
+ * coefficients and the secret, keyed encoders only the secret, and
+ * decoders one share per row.
+ */
+static unsigned int
+_gfshare_ctx_rows( int keyed,
+                   int decoding,
+                   unsigned int sharecount,
+                   unsigned int threshold )
+{
+  if( decoding )
+    return sharecount;
+  return keyed ? 1 : threshold;
+}
 
-/* ------------------------------------------------------[ Preparation ]---- */
+/* The layout of a context's current shape */
+static void
+_gfshare_ctx_layout_of( const gfshare_ctx* ctx, _gfshare_layout* layout )
+{
+  int decoding = ctx->lagrange != NULL;
+  _gfshare_ctx_layout( layout, ctx->sharecount, ctx->threshold, ctx->maxsize,
+                       _gfshare_ctx_rows( ctx->keyed, decoding,
+                                          ctx->sharecount, ctx->threshold ),
+                       ctx->keyed, decoding );
+}
+
+/* Encoders copy the secret into the row after their coefficients */
+static void
+_gfshare_ctx_default_secret( gfshare_ctx* ctx )
+{
+  ctx->secret = ctx->buffer;
+  if( ctx->lagrange == NULL && !ctx->keyed )
+    ctx->secret = ctx->buffer + ((ctx->threshold-1) * ctx->stride);
+}
+
+/* Point a context's shape at 'layout' within its own block */
+static void
+_gfshare_ctx_shape( gfshare_ctx* ctx,
+                    const _gfshare_layout* layout,
+                    const unsigned char* sharenrs,
+                    unsigned int sharecount,
+                    unsigned int threshold,
+                    unsigned int maxsize )
+{
+  unsigned char *block = (unsigned char*)ctx;
+
+  ctx->sharecount = sharecount;
+  ctx->threshold = threshold;
+  ctx->maxsize = maxsize;
+  ctx->size = maxsize;
+  ctx->target = 0;
+  ctx->lagrange = layout->lagrange ? block + layout->lagrange : NULL;
+  ctx->sharenrs = block + layout->nrs;
+  memcpy( ctx->sharenrs, sharenrs, sharecount );
+  ctx->stride = GFSHARE_ALIGNED(maxsize);
+  ctx->buffer = block + layout->buffer;
+  ctx->scratch = layout->scratch ? block + layout->scratch : NULL;
+  ctx->scratchsize = layout->scratchsize;
+  _gfshare_ctx_default_secret( ctx );
+}
 
 static gfshare_ctx *
 _gfshare_ctx_init_core( const unsigned char *sharenrs,
                         unsigned int sharecount,
-                        unsigned char threshold,
-                        unsigned int maxsize )
+                        unsigned int threshold,
+                        unsigned int maxsize,
+                        int keyed,
+                        int decoding )
 {
+  const gfshare_allocator *allocator = _gfshare_allocator_get();
   gfshare_ctx *ctx;
+  _gfshare_layout layout;
 
   /* Size must be nonzero, and 1 <= threshold <= sharecount */
   if( maxsize < 1 || threshold < 1 || threshold > sharecount ) {
     errno = EINVAL;
     return NULL;
   }
-  
-  ctx = XMALLOC( sizeof(struct _gfshare_ctx) );
+
+  _gfshare_ctx_layout( &layout, sharecount, threshold, maxsize,
+                       _gfshare_ctx_rows( keyed, decoding, sharecount,
+                                          threshold ),
+                       keyed, decoding );
+  ctx = _gfshare_alloc( allocator, layout.end );
   if( ctx == NULL )
-    return NULL; /* errno should still be set from XMALLOC() */
-  
-  ctx->sharecount = sharecount;
-  ctx->threshold = threshold;
-  ctx->maxsize = maxsize;
-  ctx->size = maxsize;
-  ctx->sharenrs = XMALLOC( sharecount );
-  
-  if( ctx->sharenrs == NULL ) {
-    int saved_errno = errno;
-    XFREE( ctx );
-    errno = saved_errno;
-    return NULL;
-  }
-  
-  memcpy( ctx->sharenrs, sharenrs, sharecount );
-  ctx->buffer = XMALLOC( sharecount * maxsize );
-  
-  if( ctx->buffer == NULL ) {
-    int saved_errno = errno;
-    XFREE( ctx->sharenrs );
-    XFREE( ctx );
-    errno = saved_errno;
-    return NULL;
-  }
-  
+    return NULL; /* errno should still be set from _gfshare_alloc() */
+  memset( ctx, 0, layout.buffer );
+
+  ctx->allocator = *allocator;
+  ctx->blocksize = layout.end;
+  ctx->threads = 1;
+  ctx->kernel = _gfshare_kernel_active();
+  ctx->weightcache = NULL;
+  ctx->weightstamps = NULL;
+  ctx->weightclock = 0;
+  ctx->keyed = keyed;
+#ifdef GFSHARE_STATS
+  ctx->stats = (_gfshare_stats_block*)((unsigned char*)ctx +
+                                       _gfshare_stats_offset());
+#endif
+  _gfshare_ctx_shape( ctx, &layout, sharenrs, sharecount, threshold,
+                      maxsize );
   return ctx;
 }
 
-/* Initialise a gfshare context for producing shares */
-gfshare_ctx *
-gfshare_ctx_init_enc( const unsigned char* sharenrs,
-                      unsigned int sharecount,
-                      unsigned char threshold,
-                      unsigned int maxsize )
+/* Share numbers must differ, or the interpolation divides by zero. A
+ * decoder may have zeros for shares it doesn't have; an encoder may not.
+ */
+static int
+_gfshare_check_sharenrs( const unsigned char* sharenrs,
+                         unsigned int sharecount,
+                         int decoding )
 {
+  unsigned char seen[256];
   unsigned int i;
 
+  /* share numbers are the non-zero bytes, so no more than 255 can differ */
+  if (!decoding && sharecount > 255) {
+    errno = EINVAL;
+    return 1;
+  }
+  memset( seen, 0, sizeof(seen) );
   for (i = 0; i < sharecount; i++) {
-    if (sharenrs[i] == 0) {
+    if (sharenrs[i] == 0 && !decoding) {
       /* can't have x[i] = 0 - that would just be a copy of the secret, in
        * theory (in fact, due to the way we use exp/log for multiplication and
        * treat log(0) as 0, it ends up as a copy of x[i] = 1) */
       errno = EINVAL;
-      return NULL;
+      return 1;
+    }
+    if (sharenrs[i] != 0 && seen[sharenrs[i]]++) {
+      errno = EINVAL;
+      return 1;
     }
   }
+  return 0;
+}
+
+/* Initialise a gfshare context for producing shares */
+gfshare_ctx *
+gfshare_ctx_init_enc( const unsigned char* sharenrs,
+                      unsigned int sharecount,
+                      unsigned char threshold,
+                      unsigned int maxsize )
+{
+  if( _gfshare_check_sharenrs( sharenrs, sharecount, 0 ) )
+    return NULL;
 
-  return _gfshare_ctx_init_core( sharenrs, sharecount, threshold, maxsize );
+  return _gfshare_ctx_init_core( sharenrs, sharecount, threshold, maxsize,
+                                 0, 0 );
 }
 
+/* Initialise a gfshare context for producing shares whose coefficients
+ * are derived from a key, rather than stored
+ */
+gfshare_ctx *
+gfshare_ctx_init_enc_keyed( const unsigned char* sharenrs,
+                            unsigned int sharecount,
+                            unsigned char threshold,
+                            unsigned int maxsize )
+{
+  if( _gfshare_check_sharenrs( sharenrs, sharecount, 0 ) )
+    return NULL;
+
+  /* Only the copy of the secret is kept; see _gfshare_ctx_enc_range() */
+  return _gfshare_ctx_init_core( sharenrs, sharecount, threshold, maxsize,
+                                 1, 0 );
+}
+
+static void _gfshare_ctx_dec_lagrange( gfshare_ctx* ctx );
+
 /* Initialise a gfshare context for recombining shares */
 gfshare_ctx*
 gfshare_ctx_init_dec( const unsigned char* sharenrs,
@@ -134,14 +386,148 @@ gfshare_ctx_init_dec( const unsigned char* sharenrs,
                       unsigned int threshold,
                       unsigned int maxsize )
 {
-  return _gfshare_ctx_init_core( sharenrs, sharecount, threshold, maxsize );
+  gfshare_ctx *ctx;
+
+  if( _gfshare_check_sharenrs( sharenrs, sharecount, 1 ) )
+    return NULL;
+  ctx = _gfshare_ctx_init_core( sharenrs, sharecount, threshold, maxsize,
+                                0, 1 );
+  if( ctx == NULL )
+    return NULL;
+  _gfshare_ctx_dec_lagrange( ctx );
+  return ctx;
+}
+
+/* Wipe and drop a decoder's cache of subset weights */
+static void
+_gfshare_ctx_drop_weights( gfshare_ctx* ctx )
+{
+  if( ctx->weightcache == NULL )
+    return;
+  _gfshare_wipe( ctx->weightcache,
+                 GFSHARE_WEIGHT_ENTRIES * 2 * ctx->sharecount );
+  _gfshare_free( &ctx->allocator, ctx->weightcache,
+                 GFSHARE_WEIGHT_ENTRIES * 2 * ctx->sharecount );
+  _gfshare_free( &ctx->allocator, ctx->weightstamps,
+                 GFSHARE_WEIGHT_ENTRIES * sizeof(unsigned int) );
+  ctx->weightcache = NULL;
+  ctx->weightstamps = NULL;
+  ctx->weightclock = 0;
+}
+
+/* Wipe the key and the part of the block holding the current shape's
+ * share numbers, weights and buffer; anything past that was wiped when
+ * it was last used.
+ */
+static void
+_gfshare_ctx_wipe_shape( gfshare_ctx* ctx )
+{
+  _gfshare_layout layout;
+  _gfshare_ctx_layout_of( ctx, &layout );
+  _gfshare_wipe( ctx->key, sizeof(ctx->key) );
+  _gfshare_wipe( (unsigned char*)ctx + layout.nrs, layout.end - layout.nrs );
+}
+
+/* Forget everything a context has been given since it was initialised */
+void
+gfshare_ctx_reset( gfshare_ctx* ctx )
+{
+  _gfshare_layout layout;
+
+  _gfshare_ctx_layout_of( ctx, &layout );
+  _gfshare_wipe( (unsigned char*)ctx + layout.buffer,
+                 layout.end - layout.buffer );
+  _gfshare_wipe( ctx->key, sizeof(ctx->key) );
+  if( ctx->weightcache != NULL ) {
+    _gfshare_wipe( ctx->weightcache,
+                   GFSHARE_WEIGHT_ENTRIES * 2 * ctx->sharecount );
+    memset( ctx->weightstamps, 0,
+            GFSHARE_WEIGHT_ENTRIES * sizeof(unsigned int) );
+    ctx->weightclock = 0;
+  }
+  ctx->size = ctx->maxsize;
+  _gfshare_ctx_default_secret( ctx );
+  if( ctx->target != 0 ) {
+    ctx->target = 0;
+    _gfshare_ctx_dec_lagrange( ctx );
+  }
+}
+
+/* Give a context a new shape, keeping its kind, backend, thread count,
+ * statistics and hook. The block is reused if the new shape fits in it,
+ * and otherwise replaced by one at least twice the size.
+ */
+gfshare_ctx*
+gfshare_ctx_reconfigure( gfshare_ctx* ctx,
+                         const unsigned char* sharenrs,
+                         unsigned int sharecount,
+                         unsigned int threshold,
+                         unsigned int maxsize )
+{
+  int decoding = ctx->lagrange != NULL;
+  _gfshare_layout layout;
+  gfshare_ctx *newctx;
+  size_t blocksize, oldsize;
+
+  if( maxsize < 1 || threshold < 1 || threshold > sharecount ) {
+    errno = EINVAL;
+    return NULL;
+  }
+  /* The same checks as initialising a context of this kind */
+  if( (!decoding && threshold > 255) ||
+      _gfshare_check_sharenrs( sharenrs, sharecount, decoding ) ) {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  _gfshare_ctx_layout( &layout, sharecount, threshold, maxsize,
+                       _gfshare_ctx_rows( ctx->keyed, decoding, sharecount,
+                                          threshold ),
+                       ctx->keyed, decoding );
+  newctx = ctx;
+  oldsize = blocksize = ctx->blocksize;
+  if( layout.end > blocksize ) {
+    blocksize = (blocksize > ((size_t)-1) / 2) ? layout.end : blocksize * 2;
+    if( blocksize < layout.end )
+      blocksize = layout.end;
+    newctx = _gfshare_alloc( &ctx->allocator, blocksize );
+    if( newctx == NULL )
+      return NULL; /* errno should still be set from _gfshare_alloc() */
+  }
+
+  /* The old context stays usable until nothing more can fail */
+  if( ctx->sharecount != sharecount )
+    _gfshare_ctx_drop_weights( ctx );
+  else if( ctx->weightcache != NULL ) {
+    memset( ctx->weightstamps, 0,
+            GFSHARE_WEIGHT_ENTRIES * sizeof(unsigned int) );
+    ctx->weightclock = 0;
+  }
+  _gfshare_ctx_wipe_shape( ctx );
+  if( newctx != ctx ) {
+    memcpy( newctx, ctx, layout.nrs );
+    newctx->blocksize = blocksize;
+#ifdef GFSHARE_STATS
+    newctx->stats = (_gfshare_stats_block*)((unsigned char*)newctx +
+                                            _gfshare_stats_offset());
+#endif
+    /* the wipe clears ctx->blocksize too, so free with the copy */
+    _gfshare_wipe( ctx, oldsize );
+    _gfshare_free( &newctx->allocator, ctx, oldsize );
+  }
+
+  _gfshare_ctx_shape( newctx, &layout, sharenrs, sharecount, threshold,
+                      maxsize );
+  if( decoding )
+    _gfshare_ctx_dec_lagrange( newctx );
+  return newctx;
 }
 
 /* Set the current processing size */
 int
 gfshare_ctx_setsize( gfshare_ctx* ctx, unsigned int size )
 {
-  if( size < 1 || size >= ctx->maxsize ) {
+  if( size < 1 || size > ctx->maxsize ) {
     errno = EINVAL;
     return 1;
   }
@@ -149,29 +535,265 @@ gfshare_ctx_setsize( gfshare_ctx* ctx, unsigned int size )
   return 0;
 }
 
+/* Set how many threads the context may use for each operation */
+int
+gfshare_ctx_set_threads( gfshare_ctx* ctx, unsigned int threads )
+{
+#ifdef HAVE_PTHREAD_H
+  if( threads == 0 ) {
+    long online = sysconf( _SC_NPROCESSORS_ONLN );
+    threads = (online > 0) ? online : 1;
+  }
+  ctx->threads = MIN(threads, GFSHARE_MAX_THREADS);
+  return 0;
+#else
+  (void)ctx;
+  if( threads > 1 ) {
+    errno = ENOTSUP;
+    return 1;
+  }
+  return 0;
+#endif
+}
+
+/* Range functions are told which worker they are, from 0, and return
+ * nonzero, with errno set, if they fail
+ */
+typedef int (*_gfshare_range_func_t)( const gfshare_ctx*, void*,
+                                      unsigned int, unsigned int,
+                                      unsigned int );
+
+typedef struct {
+  const gfshare_ctx *ctx;
+  _gfshare_range_func_t func;
+  void *arg;
+  unsigned int worker;
+  unsigned int offset;
+  unsigned int count;
+  int error;
+} _gfshare_range_job;
+
+#ifdef HAVE_PTHREAD_H
+static void*
+_gfshare_range_job_run( void* arg )
+{
+  _gfshare_range_job *job = arg;
+  job->error = 0;
+  if( job->func( job->ctx, job->arg, job->worker, job->offset,
+                 job->count ) )
+    job->error = errno;
+  return NULL;
+}
+#endif
+
+/* Divide [0, size) between the context's threads, calling 'func'
+ * on each part. Every byte position is independent, so this produces
+ * exactly what a single call over the whole range would.
+ */
+static int
+_gfshare_ctx_parallel( const gfshare_ctx* ctx,
+                       unsigned int size,
+                       _gfshare_range_func_t func,
+                       void* arg )
+{
+#ifdef HAVE_PTHREAD_H
+  _gfshare_range_job jobs[GFSHARE_MAX_THREADS];
+  pthread_t threads[GFSHARE_MAX_THREADS];
+  int started[GFSHARE_MAX_THREADS];
+  unsigned int workers = MIN(ctx->threads, size / GFSHARE_THREAD_MIN);
+  unsigned int chunk, offset, i;
+
+  if( workers > 1 ) {
+    /* Keep the chunk boundaries on cache lines so workers don't share */
+    chunk = (((size + workers - 1) / workers) + 63) & ~63u;
+    for( i = 0, offset = 0; offset < size; ++i, offset += chunk ) {
+      jobs[i].ctx = ctx;
+      jobs[i].func = func;
+      jobs[i].arg = arg;
+      jobs[i].worker = i;
+      jobs[i].offset = offset;
+      jobs[i].count = MIN(chunk, size - offset);
+    }
+    workers = i;
+    /* The calling thread takes the first chunk itself. If a thread can't
+     * be started, its chunk is done here after ours instead.
+     */
+    for( i = 1; i < workers; ++i )
+      started[i] = pthread_create( &threads[i], NULL,
+                                   _gfshare_range_job_run, &jobs[i] ) == 0;
+    _gfshare_range_job_run( &jobs[0] );
+    for( i = 1; i < workers; ++i ) {
+      if( started[i] )
+        pthread_join( threads[i], NULL );
+      else
+        _gfshare_range_job_run( &jobs[i] );
+    }
+    for( i = 0; i < workers; ++i ) {
+      if( jobs[i].error ) {
+        errno = jobs[i].error;
+        return 1;
+      }
+    }
+    return 0;
+  }
+#endif
+  return func( ctx, arg, 0, 0, size );
+}
+
 /* Free a share context's memory. */
 void 
 gfshare_ctx_free( gfshare_ctx* ctx )
 {
-  gfshare_fill_rand( ctx->buffer, ctx->sharecount * ctx->maxsize );
-  gfshare_fill_rand( ctx->sharenrs, ctx->sharecount );
-  XFREE( ctx->sharenrs );
-  XFREE( ctx->buffer );
-  gfshare_fill_rand( (unsigned char*)ctx, sizeof(struct _gfshare_ctx) );
-  XFREE( ctx );
+  gfshare_allocator allocator = ctx->allocator;
+  size_t blocksize = ctx->blocksize;
+  _gfshare_ctx_drop_weights( ctx );
+  /* the context, share numbers, weights and buffer all go at once */
+  _gfshare_wipe( ctx, blocksize );
+  _gfshare_free( &allocator, ctx, blocksize );
 }
 
 /* --------------------------------------------------------[ Splitting ]---- */
 
+/* Pick fresh coefficients for the polynomial */
+static void
+_gfshare_ctx_enc_scramble( gfshare_ctx* ctx )
+{
+  unsigned int bytes = ctx->keyed ? sizeof(ctx->key)
+                                  : (ctx->threshold-1) * ctx->stride;
+  GFSHARE_PHASE_BEGIN( ctx, GFSHARE_PHASE_RAND, bytes );
+  gfshare_fill_rand( ctx->keyed ? ctx->key : ctx->buffer, bytes );
+  GFSHARE_PHASE_END( ctx, GFSHARE_PHASE_RAND, bytes );
+}
+
 /* Provide a secret to the encoder. (this re-scrambles the coefficients) */
 void 
 gfshare_ctx_enc_setsecret( gfshare_ctx* ctx,
                            const unsigned char* secret)
 {
-  memcpy( ctx->buffer + ((ctx->threshold-1) * ctx->maxsize),
-          secret,
-          ctx->size );
-  gfshare_fill_rand( ctx->buffer, (ctx->threshold-1) * ctx->maxsize );
+  unsigned char *row = ctx->buffer;
+  GFSHARE_PHASE_BEGIN( ctx, GFSHARE_PHASE_SETSECRET, ctx->size );
+  if( !ctx->keyed )
+    row += (ctx->threshold-1) * ctx->stride;
+  memcpy( row, secret, ctx->size );
+  ctx->secret = row;
+  _gfshare_ctx_enc_scramble( ctx );
+  GFSHARE_PHASE_END( ctx, GFSHARE_PHASE_SETSECRET, ctx->size );
+}
+
+/* Provide a secret to the encoder without copying it. (this re-scrambles
+ * the coefficients)
+ */
+void
+gfshare_ctx_enc_setsecret_nocopy( gfshare_ctx* ctx,
+                                  const unsigned char* secret)
+{
+  GFSHARE_PHASE_BEGIN( ctx, GFSHARE_PHASE_SETSECRET, ctx->size );
+  ctx->secret = secret;
+  _gfshare_ctx_enc_scramble( ctx );
+  GFSHARE_PHASE_END( ctx, GFSHARE_PHASE_SETSECRET, ctx->size );
+}
+
+/* Copy out the key a keyed encoder's current coefficients come from */
+int
+gfshare_ctx_enc_getkey( const gfshare_ctx* ctx,
+                        unsigned char* key )
+{
+  if( !ctx->keyed ) {
+    errno = EINVAL;
+    return 1;
+  }
+  memcpy( key, ctx->key, sizeof(ctx->key) );
+  return 0;
+}
+
+/* Replace the key a keyed encoder's coefficients come from */
+int
+gfshare_ctx_enc_setkey( gfshare_ctx* ctx,
+                        const unsigned char* key )
+{
+  if( !ctx->keyed ) {
+    errno = EINVAL;
+    return 1;
+  }
+  memcpy( ctx->key, key, sizeof(ctx->key) );
+  return 0;
+}
+
+/* Evaluate shares [first, first+count) of the context for bytes
+ * [offset, offset+length), writing each to out[n - first] + offset.
+ * Keyed contexts generate the coefficient rows for the tile into
+ * 'scratch', which must hold (threshold-1) * length bytes.
+ */
+static void
+_gfshare_ctx_enc_tile( const gfshare_ctx* ctx,
+                       unsigned char* const* out,
+                       unsigned int first,
+                       unsigned int count,
+                       unsigned int offset,
+                       unsigned int length,
+                       unsigned char* scratch )
+{
+  const unsigned char *rows[256];
+  unsigned int coefficient, power, ilog, sharenr;
+
+  for( coefficient = 0; coefficient < ctx->threshold - 1; ++coefficient ) {
+    if( ctx->keyed ) {
+      rows[coefficient] = scratch + (coefficient * length);
+      _gfshare_chacha20( ctx->key, coefficient, offset,
+                         scratch + (coefficient * length), length );
+    } else {
+      rows[coefficient] = ctx->buffer + (coefficient * ctx->stride) + offset;
+    }
+  }
+
+  for( sharenr = first; sharenr < first + count; ++sharenr ) {
+    unsigned char *share = out[sharenr - first] + offset;
+    /* Rather than Horner's rule, sum each coefficient row times the
+     * matching power of x; that is the same polynomial, but each row is
+     * then a single multiply-accumulate which the kernel can vectorise.
+     */
+    ilog = logs[ctx->sharenrs[sharenr]];
+    memcpy( share, ctx->secret + offset, length );
+    power = 0;
+    for( coefficient = ctx->threshold - 1; coefficient-- > 0; ) {
+      power = (power + ilog) % 0xff;
+      ctx->kernel->muladd( share, rows[coefficient], exps[power], length );
+    }
+  }
+}
+
+typedef struct {
+  unsigned char* const* shares;
+  unsigned int first;
+  unsigned int count;
+} _gfshare_enc_job;
+
+static int
+_gfshare_ctx_enc_range( const gfshare_ctx* ctx,
+                        void* arg,
+                        unsigned int worker,
+                        unsigned int start,
+                        unsigned int length )
+{
+  _gfshare_enc_job *job = arg;
+  unsigned int offset, tile, count;
+  unsigned char *scratch = NULL;
+  /* Work across the buffer a tile at a time, producing that tile of every
+   * share before moving on, so the threshold coefficient tiles are still
+   * in cache for each share rather than being re-read from memory (or,
+   * for keyed contexts, regenerated into this worker's scratch).
+   */
+  tile = MIN(_gfshare_tile( ctx->threshold ), GFSHARE_ALIGNED(ctx->maxsize));
+  if( ctx->scratch != NULL )
+    scratch = ctx->scratch + (worker * ctx->scratchsize);
+  for( offset = start; offset < start + length; offset += tile ) {
+    count = MIN(tile, start + length - offset);
+    _gfshare_ctx_enc_tile( ctx, job->shares, job->first, job->count,
+                           offset, count, scratch );
+  }
+  if( scratch != NULL )
+    _gfshare_wipe( scratch, ctx->scratchsize );
+  return 0;
 }
 
 /* Extract a share from the context. 
@@ -183,37 +805,163 @@ gfshare_ctx_enc_getshare( const gfshare_ctx* ctx,
                           unsigned char sharenr,
                           unsigned char* share)
 {
+  _gfshare_enc_job job;
+  int ret;
   if (sharenr >= ctx->sharecount) {
     errno = EINVAL;
     return 1;
   }
-  unsigned int pos, coefficient;
-  unsigned int ilog = logs[ctx->sharenrs[sharenr]];
-  unsigned char *coefficient_ptr = ctx->buffer;
-  unsigned char *share_ptr;
-  for( pos = 0; pos < ctx->size; ++pos )
-    share[pos] = *(coefficient_ptr++);
-  for( coefficient = 1; coefficient < ctx->threshold; ++coefficient ) {
-    share_ptr = share;
-    coefficient_ptr = ctx->buffer + coefficient * ctx->maxsize;
-    for( pos = 0; pos < ctx->size; ++pos ) {
-      unsigned char share_byte = *share_ptr;
-      if( share_byte )
-        share_byte = exps[ilog + logs[share_byte]];
-      *share_ptr++ = share_byte ^ *coefficient_ptr++;
-    }
+  GFSHARE_PHASE_BEGIN( ctx, GFSHARE_PHASE_GETSHARE, ctx->size );
+  job.shares = &share;
+  job.first = sharenr;
+  job.count = 1;
+  ret = _gfshare_ctx_parallel( ctx, ctx->size, _gfshare_ctx_enc_range, &job );
+  GFSHARE_PHASE_END( ctx, GFSHARE_PHASE_GETSHARE, ctx->size );
+  return ret;
+}
+
+/* Extract every share from the context in a single sweep.
+ * 'shares' holds 'sharecount' buffers, one per entry in 'sharenrs', each
+ * preallocated and at least 'size' bytes long.
+ */
+int
+gfshare_ctx_enc_getshares( const gfshare_ctx* ctx,
+                           unsigned char* const* shares )
+{
+  _gfshare_enc_job job;
+  int ret;
+  GFSHARE_PHASE_BEGIN( ctx, GFSHARE_PHASE_GETSHARE,
+                       (unsigned long long)ctx->size * ctx->sharecount );
+  job.shares = shares;
+  job.first = 0;
+  job.count = ctx->sharecount;
+  ret = _gfshare_ctx_parallel( ctx, ctx->size, _gfshare_ctx_enc_range, &job );
+  GFSHARE_PHASE_END( ctx, GFSHARE_PHASE_GETSHARE,
+                     (unsigned long long)ctx->size * ctx->sharecount );
+  return ret;
+}
+
+/* Split 'count' secrets of 'length' bytes, stored back to back in
+ * 'secrets', in one call. Every byte position of a context already has
+ * its own coefficients, so the batch is simply one long secret, split a
+ * 'maxsize' chunk at a time with fresh coefficients for each chunk; the
+ * kernels then run across many secrets at once instead of a few bytes of
+ * each.
+ */
+int
+gfshare_ctx_enc_batch( gfshare_ctx* ctx,
+                       const unsigned char* secrets,
+                       unsigned int count,
+                       unsigned int length,
+                       unsigned char* const* shares )
+{
+  unsigned char *out[256];
+  unsigned long long total = (unsigned long long)count * length, done;
+  unsigned int size = ctx->size, chunk, i;
+  _gfshare_enc_job job;
+  int ret = 0;
+
+  GFSHARE_PHASE_BEGIN( ctx, GFSHARE_PHASE_GETSHARE, total * ctx->sharecount );
+  job.shares = out;
+  job.first = 0;
+  job.count = ctx->sharecount;
+  for( done = 0; done < total && ret == 0; done += chunk ) {
+    chunk = MIN(ctx->maxsize, total - done);
+    for( i = 0; i < ctx->sharecount; ++i )
+      out[i] = shares[i] + done;
+    ctx->size = chunk;
+    gfshare_ctx_enc_setsecret_nocopy( ctx, secrets + done );
+    ret = _gfshare_ctx_parallel( ctx, chunk, _gfshare_ctx_enc_range, &job );
   }
-  return 0;
+  ctx->size = size;
+  /* Don't leave the context pointing into the caller's secrets */
+  _gfshare_ctx_default_secret( ctx );
+  GFSHARE_PHASE_END( ctx, GFSHARE_PHASE_GETSHARE, total * ctx->sharecount );
+  return ret;
 }
 
 /* ----------------------------------------------------[ Recombination ]---- */
 
+/* Compute L(i) at 'x' as per Lagrange Interpolation for each of the first
+ * 'threshold' non-zero entries of 'sharenrs', and 0 for the rest. At x = 0
+ * the weights give the secret; anywhere else, the share numbered x.
+ */
+static void
+_gfshare_lagrange( const unsigned char* sharenrs,
+                   unsigned int sharecount,
+                   unsigned int threshold,
+                   unsigned char x,
+                   unsigned char* lagrange )
+{
+  unsigned int i, j, n, jn;
+
+  memset( lagrange, 0, sharecount );
+  
+  for( n = i = 0; n < threshold && i < sharecount; ++n, ++i ) {
+    unsigned Li_top = 0, Li_bottom = 0;
+    int vanishes = 0;
+    
+    if( sharenrs[i] == 0 ) {
+      n--;
+      continue; /* this share is not provided. */
+    }
+    
+    for( jn = j = 0; jn < threshold && j < sharecount; ++jn, ++j ) {
+      if( i == j ) continue;
+      if( sharenrs[j] == 0 ) {
+        jn--;
+        continue; /* skip empty share */
+      }
+      if( (x ^ sharenrs[j]) == 0 )
+        vanishes = 1; /* x is another of the shares, so L(i) is zero */
+      Li_top += logs[x ^ sharenrs[j]];
+      Li_bottom += logs[(sharenrs[i]) ^ (sharenrs[j])];
+    }
+    Li_bottom %= 0xff;
+    Li_top += 0xff - Li_bottom;
+    Li_top %= 0xff;
+    /* Li_top is now log(L(i)) */
+    lagrange[i] = vanishes ? 0 : exps[Li_top];
+  }
+}
+
+/* The context's own weights only depend on the share numbers, so they are
+ * recomputed whenever those change rather than on every extraction.
+ */
+static void
+_gfshare_ctx_dec_lagrange( gfshare_ctx* ctx )
+{
+  GFSHARE_PHASE_BEGIN( ctx, GFSHARE_PHASE_LAGRANGE, ctx->sharecount );
+  _gfshare_lagrange( ctx->sharenrs, ctx->sharecount, ctx->threshold,
+                     ctx->target, ctx->lagrange );
+  GFSHARE_PHASE_END( ctx, GFSHARE_PHASE_LAGRANGE, ctx->sharecount );
+}
+
 /* Inform a recombination context of a change in share indexes */
 void 
 gfshare_ctx_dec_newshares( gfshare_ctx* ctx,
                            const unsigned char* sharenrs)
 {
+  if( memcmp( ctx->sharenrs, sharenrs, ctx->sharecount ) == 0 )
+    return;
   memcpy( ctx->sharenrs, sharenrs, ctx->sharecount );
+  _gfshare_ctx_dec_lagrange( ctx );
+}
+
+/* Interpolate to share number 'sharenr' rather than to the secret */
+int
+gfshare_ctx_dec_settarget( gfshare_ctx* ctx,
+                           unsigned char sharenr )
+{
+  if( ctx->lagrange == NULL ) {
+    errno = EINVAL;
+    return 1;
+  }
+  if( ctx->target == sharenr )
+    return 0;
+  ctx->target = sharenr;
+  _gfshare_ctx_dec_lagrange( ctx );
+  return 0;
 }
 
 /* Provide a share context with one of the shares.
@@ -228,7 +976,40 @@ gfshare_ctx_dec_giveshare( gfshare_ctx* ctx,
     errno = EINVAL;
     return 1;
   }
-  memcpy( ctx->buffer + (sharenr * ctx->maxsize), share, ctx->size );
+  GFSHARE_PHASE_BEGIN( ctx, GFSHARE_PHASE_GIVESHARE, ctx->size );
+  memcpy( ctx->buffer + (sharenr * ctx->stride), share, ctx->size );
+  GFSHARE_PHASE_END( ctx, GFSHARE_PHASE_GIVESHARE, ctx->size );
+  return 0;
+}
+
+typedef struct {
+  const unsigned char* const* shares; /* NULL to use the context buffer */
+  const unsigned char* lagrange;
+  unsigned char* secretbuf;
+} _gfshare_dec_job;
+
+static int
+_gfshare_ctx_dec_range( const gfshare_ctx* ctx,
+                        void* arg,
+                        unsigned int worker,
+                        unsigned int offset,
+                        unsigned int count )
+{
+  _gfshare_dec_job *job = arg;
+  const unsigned char *share;
+  unsigned int i;
+
+  (void)worker;
+  memset(job->secretbuf + offset, 0, count);
+  
+  for( i = 0; i < ctx->sharecount; ++i ) {
+    if( job->lagrange[i] == 0 )
+      continue;
+    share = (job->shares != NULL) ? job->shares[i]
+                                  : ctx->buffer + (ctx->stride * i);
+    ctx->kernel->muladd( job->secretbuf + offset, share + offset,
+                         job->lagrange[i], count );
+  }
   return 0;
 }
 
@@ -239,39 +1020,234 @@ void
 gfshare_ctx_dec_extract( const gfshare_ctx* ctx,
                          unsigned char* secretbuf )
 {
-  unsigned int i, j, n, jn;
-  unsigned char *secret_ptr, *share_ptr;
+  _gfshare_dec_job job;
+  GFSHARE_PHASE_BEGIN( ctx, GFSHARE_PHASE_EXTRACT, ctx->size );
+  job.shares = NULL;
+  job.lagrange = ctx->lagrange;
+  job.secretbuf = secretbuf;
+  (void)_gfshare_ctx_parallel( ctx, ctx->size, _gfshare_ctx_dec_range, &job );
+  GFSHARE_PHASE_END( ctx, GFSHARE_PHASE_EXTRACT, ctx->size );
+}
 
-  memset(secretbuf, 0, ctx->size);
-  
-  for( n = i = 0; n < ctx->threshold && i < ctx->sharecount; ++n, ++i ) {
-    /* Compute L(i) as per Lagrange Interpolation */
-    unsigned Li_top = 0, Li_bottom = 0;
-    
-    if( ctx->sharenrs[i] == 0 ) {
-      n--;
-      continue; /* this share is not provided. */
-    }
-    
-    for( jn = j = 0; jn < ctx->threshold && j < ctx->sharecount; ++jn, ++j ) {
-      if( i == j ) continue;
-      if( ctx->sharenrs[j] == 0 ) {
-        jn--;
-        continue; /* skip empty share */
-      }
-      Li_top += logs[ctx->sharenrs[j]];
-      Li_bottom += logs[(ctx->sharenrs[i]) ^ (ctx->sharenrs[j])];
+/* Extract the secret by interpolation of shares held by the caller.
+ * 'shares' has an entry per 'sharenrs' entry; each must be at least 'size'
+ * bytes long, except that entries whose share number is 0 may be NULL.
+ */
+void
+gfshare_ctx_dec_extract_shares( const gfshare_ctx* ctx,
+                                const unsigned char* const* shares,
+                                unsigned char* secretbuf,
+                                unsigned int size )
+{
+  _gfshare_dec_job job;
+  GFSHARE_PHASE_BEGIN( ctx, GFSHARE_PHASE_EXTRACT, size );
+  job.shares = shares;
+  job.lagrange = ctx->lagrange;
+  job.secretbuf = secretbuf;
+  (void)_gfshare_ctx_parallel( ctx, size, _gfshare_ctx_dec_range, &job );
+  GFSHARE_PHASE_END( ctx, GFSHARE_PHASE_EXTRACT, size );
+}
+
+/* Find the weights for 'sharenrs' in the context's cache, computing them
+ * into the least recently used entry of their set if they are not there.
+ */
+static const unsigned char*
+_gfshare_ctx_dec_weights( gfshare_ctx* ctx,
+                          const unsigned char* sharenrs )
+{
+  unsigned int hash = 2166136261u, i, entry, victim;
+  unsigned char *cached;
+
+  for( i = 0; i < ctx->sharecount; ++i )
+    hash = (hash ^ sharenrs[i]) * 16777619u;
+  entry = victim = (hash % GFSHARE_WEIGHT_SETS) * GFSHARE_WEIGHT_WAYS;
+  for( i = 0; i < GFSHARE_WEIGHT_WAYS; ++i, ++entry ) {
+    cached = ctx->weightcache + (entry * 2 * ctx->sharecount);
+    if( ctx->weightstamps[entry] != 0 &&
+        memcmp( cached, sharenrs, ctx->sharecount ) == 0 ) {
+      ctx->weightstamps[entry] = ++ctx->weightclock;
+      return cached + ctx->sharecount;
     }
-    Li_bottom %= 0xff;
-    Li_top += 0xff - Li_bottom;
-    Li_top %= 0xff;
-    /* Li_top is now log(L(i)) */
-    
-    secret_ptr = secretbuf; share_ptr = ctx->buffer + (ctx->maxsize * i);
-    for( j = 0; j < ctx->size; ++j ) {
-      if( *share_ptr )
-        *secret_ptr ^= exps[Li_top + logs[*share_ptr]];
-      share_ptr++; secret_ptr++;
+    if( ctx->weightstamps[entry] < ctx->weightstamps[victim] )
+      victim = entry;
+  }
+  cached = ctx->weightcache + (victim * 2 * ctx->sharecount);
+  GFSHARE_PHASE_BEGIN( ctx, GFSHARE_PHASE_LAGRANGE, ctx->sharecount );
+  memcpy( cached, sharenrs, ctx->sharecount );
+  _gfshare_lagrange( sharenrs, ctx->sharecount, ctx->threshold, 0,
+                     cached + ctx->sharecount );
+  GFSHARE_PHASE_END( ctx, GFSHARE_PHASE_LAGRANGE, ctx->sharecount );
+  ctx->weightstamps[victim] = ++ctx->weightclock;
+  return cached + ctx->sharecount;
+}
+
+/* Recombine a batch of secrets, each from its own subset of shares. Every
+ * job's share numbers are checked first, so a bad one fails the batch
+ * before any is done; then each job's weights are found, from the cache
+ * where the subset has been seen recently, and used before the next job
+ * can evict them.
+ */
+int
+gfshare_ctx_dec_extract_batch( gfshare_ctx* ctx,
+                               const gfshare_dec_job* jobs,
+                               unsigned int count )
+{
+  unsigned int j;
+  _gfshare_dec_job job;
+  int ret = 0;
+
+  for( j = 0; j < count; ++j )
+    if( _gfshare_check_sharenrs( jobs[j].sharenrs, ctx->sharecount, 1 ) )
+      return 1;
+
+  if( ctx->weightcache == NULL ) {
+    ctx->weightcache = _gfshare_alloc( &ctx->allocator,
+                                       GFSHARE_WEIGHT_ENTRIES * 2 *
+                                       ctx->sharecount );
+    ctx->weightstamps = _gfshare_alloc( &ctx->allocator,
+                                        GFSHARE_WEIGHT_ENTRIES *
+                                        sizeof(unsigned int) );
+    if( ctx->weightcache == NULL || ctx->weightstamps == NULL ) {
+      int saved_errno = errno;
+      _gfshare_free( &ctx->allocator, ctx->weightcache,
+                     GFSHARE_WEIGHT_ENTRIES * 2 * ctx->sharecount );
+      _gfshare_free( &ctx->allocator, ctx->weightstamps,
+                     GFSHARE_WEIGHT_ENTRIES * sizeof(unsigned int) );
+      ctx->weightcache = NULL;
+      ctx->weightstamps = NULL;
+      errno = saved_errno;
+      return 1;
     }
+    memset( ctx->weightstamps, 0, GFSHARE_WEIGHT_ENTRIES * sizeof(unsigned int) );
+  }
+
+  for( j = 0; j < count; ++j ) {
+    job.lagrange = _gfshare_ctx_dec_weights( ctx, jobs[j].sharenrs );
+    GFSHARE_PHASE_BEGIN( ctx, GFSHARE_PHASE_EXTRACT, jobs[j].size );
+    job.shares = jobs[j].shares;
+    job.secretbuf = jobs[j].secretbuf;
+    ret = _gfshare_ctx_parallel( ctx, jobs[j].size,
+                                 _gfshare_ctx_dec_range, &job );
+    GFSHARE_PHASE_END( ctx, GFSHARE_PHASE_EXTRACT, jobs[j].size );
+    if( ret != 0 )
+      break;
+  }
+  return ret;
+}
+
+/* ------------------------------------------------------[ Resharing ]---- */
+
+/* Turn 'size' bytes of the shares 'dec' recombines into the same bytes of
+ * the share set 'enc' produces. The tile of secret is interpolated
+ * straight into the encoder's own secret row and split again under fresh
+ * coefficients, and then it and the coefficients are wiped, so the secret
+ * only ever exists inside the encoder's block. All of the work is counted
+ * in the encoder's statistics; 'dec' is only read, so threads working on
+ * different tiles, each with its own encoder, may share one decoder.
+ */
+int
+gfshare_ctx_reshare( gfshare_ctx* enc,
+                     const gfshare_ctx* dec,
+                     const unsigned char* const* oldshares,
+                     unsigned char* const* newshares,
+                     unsigned int size )
+{
+  unsigned int oldsize = enc->size;
+  _gfshare_dec_job decjob;
+  _gfshare_enc_job encjob;
+  unsigned char *row;
+  unsigned int rows, i;
+  int ret;
+
+  /* A retargeted decoder's weights give a share, not the secret */
+  if( enc->lagrange != NULL || dec->lagrange == NULL || dec->target != 0 ||
+      size < 1 || size > enc->maxsize ) {
+    errno = EINVAL;
+    return 1;
   }
+  row = enc->buffer;
+  if( !enc->keyed )
+    row += (enc->threshold-1) * enc->stride;
+
+  GFSHARE_PHASE_BEGIN( enc, GFSHARE_PHASE_EXTRACT, size );
+  decjob.shares = oldshares;
+  decjob.lagrange = dec->lagrange;
+  decjob.secretbuf = row;
+  ret = _gfshare_ctx_parallel( dec, size, _gfshare_ctx_dec_range, &decjob );
+  GFSHARE_PHASE_END( enc, GFSHARE_PHASE_EXTRACT, size );
+
+  if( ret == 0 ) {
+    enc->size = size;
+    GFSHARE_PHASE_BEGIN( enc, GFSHARE_PHASE_SETSECRET, size );
+    enc->secret = row;
+    _gfshare_ctx_enc_scramble( enc );
+    GFSHARE_PHASE_END( enc, GFSHARE_PHASE_SETSECRET, size );
+
+    GFSHARE_PHASE_BEGIN( enc, GFSHARE_PHASE_GETSHARE,
+                         (unsigned long long)size * enc->sharecount );
+    encjob.shares = newshares;
+    encjob.first = 0;
+    encjob.count = enc->sharecount;
+    ret = _gfshare_ctx_parallel( enc, size, _gfshare_ctx_enc_range, &encjob );
+    GFSHARE_PHASE_END( enc, GFSHARE_PHASE_GETSHARE,
+                       (unsigned long long)size * enc->sharecount );
+  }
+
+  /* Any one new share and the coefficients would give the secret away */
+  _gfshare_wipe( enc->key, sizeof(enc->key) );
+  rows = enc->keyed ? 1 : enc->threshold;
+  for( i = 0; i < rows; ++i )
+    _gfshare_wipe( enc->buffer + (i * enc->stride), size );
+  enc->size = oldsize;
+  return ret;
+}
+
+/* -------------------------------------------------------[ Statistics ]---- */
+
+/* Copy out the counters the context has kept */
+int
+gfshare_ctx_get_stats( const gfshare_ctx* ctx, gfshare_stats* stats )
+{
+#ifdef GFSHARE_STATS
+  memcpy( stats, &ctx->stats->stats, sizeof(gfshare_stats) );
+  return 0;
+#else
+  (void)ctx;
+  (void)stats;
+  errno = ENOTSUP;
+  return 1;
+#endif
+}
+
+/* Zero the counters the context has kept */
+int
+gfshare_ctx_reset_stats( gfshare_ctx* ctx )
+{
+#ifdef GFSHARE_STATS
+  memset( &ctx->stats->stats, 0, sizeof(gfshare_stats) );
+  return 0;
+#else
+  (void)ctx;
+  errno = ENOTSUP;
+  return 1;
+#endif
+}
+
+/* Have 'hook' called around each phase of work on the context */
+int
+gfshare_ctx_set_hook( gfshare_ctx* ctx,
+                      gfshare_hook_func_t hook,
+                      void* data )
+{
+#ifdef GFSHARE_STATS
+  ctx->stats->hook = hook;
+  ctx->stats->hookdata = data;
+  return 0;
+#else
+  (void)ctx;
+  (void)hook;
+  (void)data;
+  errno = ENOTSUP;
+  return 1;
+#endif
 }
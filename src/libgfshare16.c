@@ -0,0 +1,422 @@
+/*
+ * This file is Copyright Daniel Silverstone <dsilvers@digital-scurf.org> 2006
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "config.h"
+#include "libgfshare.h"
+#include "gfshare_gf16.h"
+#include "gfshare_kernels.h"
+#include "gfshare_alloc.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* The gf(2**16) contexts. These work just like the gf(2**8) ones, except
+ * that share numbers go up to 65535 and every two bytes of a secret form
+ * one (little-endian) field element, so sizes must be even.
+ */
+
+#ifndef MIN
+#define MIN(a,b) (((a)<(b))?(a):(b))
+#endif
+
+/* As for gf(2**8): the cache the coefficient tiles of
+ * gfshare16_ctx_enc_getshares() may use between them, and the least
+ * worth bothering with
+ */
+#define GFSHARE16_TILE_BUDGET (128 * 1024)
+#define GFSHARE16_TILE_MIN 1024
+
+/* How many prepared coefficients gfshare16_ctx_enc_getshares() builds at
+ * once, so that a group of shares can be swept tile by tile with them
+ */
+#define GFSHARE16_MULS_BUDGET 256
+
+struct _gfshare16_ctx {
+  unsigned int sharecount;
+  unsigned int threshold;
+  unsigned int maxsize;
+  unsigned int size;
+  unsigned short* sharenrs;
+  unsigned char* buffer;
+  size_t stride; /* between rows of 'buffer': maxsize, to a cache line */
+  gfshare_mul16* lagrange; /* decoding only: L(i) per share, 0 if unused */
+  const gfshare_kernel* kernel;
+  gfshare_allocator allocator; /* which this block came from */
+  size_t blocksize;
+};
+
+/* ------------------------------------------------------[ Preparation ]---- */
+
+/* One block per context, laid out as for gf(2**8) */
+static gfshare16_ctx *
+_gfshare16_ctx_init_core( const unsigned short *sharenrs,
+                          unsigned int sharecount,
+                          unsigned int threshold,
+                          unsigned int maxsize,
+                          unsigned int rows,
+                          int decoding )
+{
+  const gfshare_allocator *allocator = _gfshare_allocator_get();
+  gfshare16_ctx *ctx;
+  unsigned char *block;
+  size_t offset, nrsoffset, lagoffset = 0, blocksize;
+
+  /* Size must be nonzero and even, and 1 <= threshold <= sharecount */
+  if( maxsize < 2 || (maxsize & 1) || threshold < 1 ||
+      threshold > sharecount || sharecount > GFSHARE_GF16_ORDER ) {
+    errno = EINVAL;
+    return NULL;
+  }
+  _gfshare_gf16_init();
+
+  offset = GFSHARE_ALIGNED(sizeof(struct _gfshare16_ctx));
+  nrsoffset = offset;
+  offset += GFSHARE_ALIGNED(sharecount * sizeof(unsigned short));
+  if( decoding ) {
+    lagoffset = offset;
+    offset += GFSHARE_ALIGNED(sharecount * sizeof(gfshare_mul16));
+  }
+  blocksize = offset + (rows * GFSHARE_ALIGNED(maxsize));
+  block = _gfshare_alloc( allocator, blocksize );
+  if( block == NULL )
+    return NULL; /* errno should still be set from _gfshare_alloc() */
+  memset( block, 0, offset );
+
+  ctx = (gfshare16_ctx*)block;
+  ctx->allocator = *allocator;
+  ctx->blocksize = blocksize;
+  ctx->sharecount = sharecount;
+  ctx->threshold = threshold;
+  ctx->maxsize = maxsize;
+  ctx->size = maxsize;
+  ctx->kernel = _gfshare_kernel_active();
+  ctx->sharenrs = (unsigned short*)(block + nrsoffset);
+  ctx->lagrange = decoding ? (gfshare_mul16*)(block + lagoffset) : NULL;
+  ctx->stride = GFSHARE_ALIGNED(maxsize);
+  ctx->buffer = block + offset;
+  memcpy( ctx->sharenrs, sharenrs, sharecount * sizeof(unsigned short) );
+  return ctx;
+}
+
+/* Share numbers must differ, or the interpolation divides by zero. A
+ * decoder may have zeros for shares it doesn't have; an encoder may not.
+ */
+static int
+_gfshare16_check_sharenrs( const unsigned short* sharenrs,
+                           unsigned int sharecount,
+                           int decoding )
+{
+  unsigned char seen[(GFSHARE_GF16_ORDER + 1) / 8];
+  unsigned int i, x;
+
+  memset( seen, 0, sizeof(seen) );
+  for( i = 0; i < sharecount; ++i ) {
+    x = sharenrs[i];
+    if( x == 0 ) {
+      if( decoding )
+        continue;
+      /* x = 0 would just be a copy of the secret */
+      errno = EINVAL;
+      return 1;
+    }
+    if( seen[x >> 3] & (1 << (x & 7)) ) {
+      errno = EINVAL;
+      return 1;
+    }
+    seen[x >> 3] |= 1 << (x & 7);
+  }
+  return 0;
+}
+
+/* Initialise a gfshare16 context for producing shares */
+gfshare16_ctx *
+gfshare16_ctx_init_enc( const unsigned short* sharenrs,
+                        unsigned int sharecount,
+                        unsigned int threshold,
+                        unsigned int maxsize )
+{
+  if( _gfshare16_check_sharenrs( sharenrs, sharecount, 0 ) )
+    return NULL;
+  /* threshold-1 rows of coefficients, then the secret */
+  return _gfshare16_ctx_init_core( sharenrs, sharecount, threshold, maxsize,
+                                   threshold, 0 );
+}
+
+static void _gfshare16_ctx_dec_lagrange( gfshare16_ctx* ctx );
+
+/* Initialise a gfshare16 context for recombining shares */
+gfshare16_ctx *
+gfshare16_ctx_init_dec( const unsigned short* sharenrs,
+                        unsigned int sharecount,
+                        unsigned int threshold,
+                        unsigned int maxsize )
+{
+  gfshare16_ctx *ctx;
+
+  if( _gfshare16_check_sharenrs( sharenrs, sharecount, 1 ) )
+    return NULL;
+  ctx = _gfshare16_ctx_init_core( sharenrs, sharecount, threshold, maxsize,
+                                  sharecount, 1 );
+  if( ctx == NULL )
+    return NULL;
+  _gfshare16_ctx_dec_lagrange( ctx );
+  return ctx;
+}
+
+/* Set the current processing size */
+int
+gfshare16_ctx_setsize( gfshare16_ctx* ctx, unsigned int size )
+{
+  if( size < 2 || (size & 1) || size > ctx->maxsize ) {
+    errno = EINVAL;
+    return 1;
+  }
+  ctx->size = size;
+  return 0;
+}
+
+/* Free a share context's memory. */
+void
+gfshare16_ctx_free( gfshare16_ctx* ctx )
+{
+  gfshare_allocator allocator = ctx->allocator;
+  size_t blocksize = ctx->blocksize;
+  _gfshare_wipe( ctx, blocksize );
+  _gfshare_free( &allocator, ctx, blocksize );
+}
+
+/* --------------------------------------------------------[ Splitting ]---- */
+
+/* Provide a secret to the encoder. (this re-scrambles the coefficients) */
+void
+gfshare16_ctx_enc_setsecret( gfshare16_ctx* ctx,
+                             const unsigned char* secret )
+{
+  memcpy( ctx->buffer + ((ctx->threshold-1) * ctx->stride), secret,
+          ctx->size );
+  gfshare_fill_rand( ctx->buffer, (ctx->threshold-1) * ctx->stride );
+}
+
+/* Evaluate 'count' shares for bytes [offset, offset+length), writing each
+ * to out[n] + offset. This is the same sum of coefficient rows times
+ * powers of x as for gf(2**8); 'muls' holds those powers for each share
+ * in turn, for the last row first.
+ */
+static void
+_gfshare16_ctx_enc_tile( const gfshare16_ctx* ctx,
+                         unsigned char* const* out,
+                         const gfshare_mul16* muls,
+                         unsigned int count,
+                         unsigned int offset,
+                         unsigned int length )
+{
+  const unsigned char *secret = ctx->buffer +
+                                ((ctx->threshold-1) * ctx->stride);
+  unsigned int coefficient, n;
+
+  for( n = 0; n < count; ++n ) {
+    unsigned char *share = out[n] + offset;
+    memcpy( share, secret + offset, length );
+    for( coefficient = ctx->threshold - 1; coefficient-- > 0; )
+      ctx->kernel->muladd16( share,
+                             ctx->buffer + (coefficient * ctx->stride) + offset,
+                             muls++, length );
+  }
+}
+
+/* The powers of x only depend on the share numbers, so they are prepared
+ * once per call for a group of shares, which is then swept a tile at a
+ * time, rather than being prepared again for every tile.
+ */
+static int
+_gfshare16_ctx_enc_shares( const gfshare16_ctx* ctx,
+                           unsigned char* const* out,
+                           unsigned int first,
+                           unsigned int count )
+{
+  unsigned int rows = ctx->threshold - 1, group, done, n, offset, tile;
+  unsigned int coefficient, power, ilog;
+  gfshare_mul16 *muls = NULL, *mul;
+  size_t bytes = 0;
+
+  group = (rows == 0) ? count : GFSHARE16_MULS_BUDGET / rows;
+  group = (group < 1) ? 1 : MIN(group, count);
+  if( rows > 0 ) {
+    bytes = (size_t)group * rows * sizeof(gfshare_mul16);
+    muls = _gfshare_alloc( &ctx->allocator, bytes );
+    if( muls == NULL )
+      return 1; /* errno should still be set from _gfshare_alloc() */
+  }
+  tile = GFSHARE16_TILE_BUDGET / ctx->threshold;
+  tile = (tile < GFSHARE16_TILE_MIN) ? GFSHARE16_TILE_MIN : (tile & ~63u);
+  for( done = 0; done < count; done += group ) {
+    group = MIN(group, count - done);
+    mul = muls;
+    for( n = 0; n < group && rows > 0; ++n ) {
+      ilog = _gfshare_logs16[ctx->sharenrs[first + done + n]];
+      power = 0;
+      for( coefficient = rows; coefficient-- > 0; ) {
+        power = (power + ilog) % GFSHARE_GF16_ORDER;
+        _gfshare_mul16_prepare( _gfshare_exps16[power], mul++ );
+      }
+    }
+    for( offset = 0; offset < ctx->size; offset += tile )
+      _gfshare16_ctx_enc_tile( ctx, out + done, muls, group, offset,
+                               MIN(tile, ctx->size - offset) );
+  }
+  if( muls != NULL )
+    _gfshare_free( &ctx->allocator, muls, bytes );
+  return 0;
+}
+
+/* Extract a share from the context.
+ * 'share' must be preallocated and at least 'size' bytes long.
+ * 'sharenr' is the index into the 'sharenrs' array of the share you want.
+ */
+int
+gfshare16_ctx_enc_getshare( const gfshare16_ctx* ctx,
+                            unsigned int sharenr,
+                            unsigned char* share )
+{
+  if( sharenr >= ctx->sharecount ) {
+    errno = EINVAL;
+    return 1;
+  }
+  return _gfshare16_ctx_enc_shares( ctx, &share, sharenr, 1 );
+}
+
+/* Extract every share from the context in a single cache-blocked sweep */
+int
+gfshare16_ctx_enc_getshares( const gfshare16_ctx* ctx,
+                             unsigned char* const* shares )
+{
+  return _gfshare16_ctx_enc_shares( ctx, shares, 0, ctx->sharecount );
+}
+
+/* ----------------------------------------------------[ Recombination ]---- */
+
+/* Compute L(i) for the first 'threshold' shares we have, as for gf(2**8),
+ * and prepare each for the kernels
+ */
+static void
+_gfshare16_ctx_dec_lagrange( gfshare16_ctx* ctx )
+{
+  unsigned int i, j, n, jn;
+
+  memset( ctx->lagrange, 0, ctx->sharecount * sizeof(gfshare_mul16) );
+
+  for( n = i = 0; n < ctx->threshold && i < ctx->sharecount; ++n, ++i ) {
+    unsigned long Li_top = 0, Li_bottom = 0;
+
+    if( ctx->sharenrs[i] == 0 ) {
+      n--;
+      continue; /* this share is not provided. */
+    }
+
+    for( jn = j = 0; jn < ctx->threshold && j < ctx->sharecount; ++jn, ++j ) {
+      if( i == j ) continue;
+      if( ctx->sharenrs[j] == 0 ) {
+        jn--;
+        continue; /* skip empty share */
+      }
+      Li_top += _gfshare_logs16[ctx->sharenrs[j]];
+      Li_bottom += _gfshare_logs16[(ctx->sharenrs[i]) ^ (ctx->sharenrs[j])];
+    }
+    Li_bottom %= GFSHARE_GF16_ORDER;
+    Li_top += GFSHARE_GF16_ORDER - Li_bottom;
+    Li_top %= GFSHARE_GF16_ORDER;
+    /* Li_top is now log(L(i)), and L(i) is never zero */
+    _gfshare_mul16_prepare( _gfshare_exps16[Li_top], &ctx->lagrange[i] );
+  }
+}
+
+/* Inform a recombination context of a change in share indexes */
+int
+gfshare16_ctx_dec_newshares( gfshare16_ctx* ctx,
+                             const unsigned short* sharenrs )
+{
+  if( memcmp( ctx->sharenrs, sharenrs,
+              ctx->sharecount * sizeof(unsigned short) ) == 0 )
+    return 0;
+  if( _gfshare16_check_sharenrs( sharenrs, ctx->sharecount, 1 ) )
+    return 1;
+  memcpy( ctx->sharenrs, sharenrs, ctx->sharecount * sizeof(unsigned short) );
+  _gfshare16_ctx_dec_lagrange( ctx );
+  return 0;
+}
+
+/* Provide a share context with one of the shares.
+ * The 'sharenr' is the index into the 'sharenrs' array
+ */
+int
+gfshare16_ctx_dec_giveshare( gfshare16_ctx* ctx,
+                             unsigned int sharenr,
+                             const unsigned char* share )
+{
+  if( sharenr >= ctx->sharecount ) {
+    errno = EINVAL;
+    return 1;
+  }
+  memcpy( ctx->buffer + (sharenr * ctx->stride), share, ctx->size );
+  return 0;
+}
+
+/* Extract the secret by interpolation of shares held by the caller, or of
+ * those given to the context if 'shares' is NULL
+ */
+int
+gfshare16_ctx_dec_extract_shares( const gfshare16_ctx* ctx,
+                                  const unsigned char* const* shares,
+                                  unsigned char* secretbuf,
+                                  unsigned int size )
+{
+  unsigned int i;
+  /* An odd byte at the end would be half a field element */
+  if( size < 2 || (size & 1) ) {
+    errno = EINVAL;
+    return 1;
+  }
+  memset( secretbuf, 0, size );
+  for( i = 0; i < ctx->sharecount; ++i ) {
+    if( ctx->lagrange[i].coeff == 0 )
+      continue;
+    ctx->kernel->muladd16( secretbuf,
+                           (shares != NULL) ? shares[i]
+                                            : ctx->buffer + (i * ctx->stride),
+                           &ctx->lagrange[i], size );
+  }
+  return 0;
+}
+
+/* Extract the secret by interpolation of the shares.
+ * secretbuf must be allocated and at least 'size' bytes long
+ */
+void
+gfshare16_ctx_dec_extract( const gfshare16_ctx* ctx,
+                           unsigned char* secretbuf )
+{
+  (void)gfshare16_ctx_dec_extract_shares( ctx, NULL, secretbuf, ctx->size );
+}
@@ -0,0 +1,162 @@
+/*
+ * This file is Copyright the libgfshare contributors 2026
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "libgfshare.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SHARECOUNT 1000
+#define THRESHOLD 50
+#define SIZE 4098
+
+/* Split a secret into more shares than gf(2**8) allows, check that
+ * gfshare16_ctx_enc_getshares() agrees with gfshare16_ctx_enc_getshare(),
+ * and recombine from a few different subsets.
+ */
+int
+main( int argc, char **argv )
+{
+  int ok = 1;
+  unsigned int i, trial;
+  unsigned char* secret = malloc(SIZE);
+  unsigned char* single = malloc(SIZE);
+  unsigned char* recomb = malloc(SIZE);
+  unsigned short* sharenrs = malloc(SHARECOUNT * sizeof(unsigned short));
+  unsigned short* subset = malloc(SHARECOUNT * sizeof(unsigned short));
+  unsigned char** shares = malloc(SHARECOUNT * sizeof(unsigned char*));
+  gfshare16_ctx *G;
+
+  for( i = 0; i < SIZE; ++i )
+    secret[i] = (random() & 0xff00) >> 8;
+  for( i = 0; i < SHARECOUNT; ++i ) {
+    /* spread the share numbers over the whole field */
+    sharenrs[i] = 1 + i * 65;
+    shares[i] = malloc(SIZE);
+  }
+
+  /* Odd sizes, share number 0 and repeated share numbers are refused */
+  if( gfshare16_ctx_init_enc( sharenrs, SHARECOUNT, THRESHOLD,
+                              SIZE - 1 ) != NULL || errno != EINVAL )
+    ok = 0;
+  sharenrs[7] = 0;
+  if( gfshare16_ctx_init_enc( sharenrs, SHARECOUNT, THRESHOLD,
+                              SIZE ) != NULL || errno != EINVAL )
+    ok = 0;
+  sharenrs[7] = sharenrs[500];
+  if( gfshare16_ctx_init_enc( sharenrs, SHARECOUNT, THRESHOLD,
+                              SIZE ) != NULL || errno != EINVAL )
+    ok = 0;
+  if( gfshare16_ctx_init_dec( sharenrs, SHARECOUNT, THRESHOLD,
+                              SIZE ) != NULL || errno != EINVAL )
+    ok = 0;
+  sharenrs[7] = 1 + 7 * 65;
+
+  G = gfshare16_ctx_init_enc( sharenrs, SHARECOUNT, THRESHOLD, SIZE );
+  if( G == NULL ) {
+    perror( "gfshare16_ctx_init_enc" );
+    return 1;
+  }
+  if( gfshare16_ctx_setsize( G, 3 ) == 0 )
+    ok = 0;
+  gfshare16_ctx_enc_setsecret( G, secret );
+  gfshare16_ctx_enc_getshares( G, shares );
+  for( i = 0; i < SHARECOUNT; i += 37 ) {
+    gfshare16_ctx_enc_getshare( G, i, single );
+    if( memcmp( single, shares[i], SIZE ) != 0 ) {
+      fprintf( stderr, "getshare/getshares mismatch for share %u\n", i );
+      ok = 0;
+    }
+  }
+  gfshare16_ctx_free( G );
+
+  G = gfshare16_ctx_init_dec( sharenrs, SHARECOUNT, THRESHOLD, SIZE );
+  for( trial = 0; trial < 4; ++trial ) {
+    unsigned int have = 0;
+    /* Keep a random THRESHOLD of the shares */
+    memset( subset, 0, SHARECOUNT * sizeof(unsigned short) );
+    while( have < THRESHOLD ) {
+      i = random() % SHARECOUNT;
+      if( subset[i] == 0 ) {
+        subset[i] = sharenrs[i];
+        ++have;
+      }
+    }
+    gfshare16_ctx_dec_newshares( G, subset );
+    if( trial & 1 ) {
+      for( i = 0; i < SHARECOUNT; ++i )
+        if( subset[i] != 0 )
+          gfshare16_ctx_dec_giveshare( G, i, shares[i] );
+      gfshare16_ctx_dec_extract( G, recomb );
+    } else {
+      gfshare16_ctx_dec_extract_shares( G, (const unsigned char* const*)shares,
+                                        recomb, SIZE );
+    }
+    if( memcmp( secret, recomb, SIZE ) != 0 ) {
+      fprintf( stderr, "recombination %u failed\n", trial );
+      ok = 0;
+    }
+  }
+
+  /* One share too few must not give the secret back */
+  for( i = 0; i < SHARECOUNT; ++i )
+    if( subset[i] != 0 ) {
+      subset[i] = 0;
+      break;
+    }
+  gfshare16_ctx_dec_newshares( G, subset );
+  gfshare16_ctx_dec_extract_shares( G, (const unsigned char* const*)shares,
+                                    recomb, SIZE );
+  if( memcmp( secret, recomb, SIZE ) == 0 )
+    ok = 0;
+
+  /* Nor may repeated share numbers or an odd size be used to recombine */
+  subset[0] = subset[1] = sharenrs[1];
+  errno = 0;
+  if( gfshare16_ctx_dec_newshares( G, subset ) == 0 || errno != EINVAL ) {
+    fprintf( stderr, "newshares accepted a repeated share number\n" );
+    ok = 0;
+  }
+  errno = 0;
+  if( gfshare16_ctx_dec_extract_shares( G, (const unsigned char* const*)shares,
+                                        recomb, SIZE - 1 ) == 0 ||
+      errno != EINVAL ) {
+    fprintf( stderr, "extract_shares accepted an odd size\n" );
+    ok = 0;
+  }
+  gfshare16_ctx_free( G );
+
+  for( i = 0; i < SHARECOUNT; ++i )
+    free(shares[i]);
+  free(shares);
+  free(subset);
+  free(sharenrs);
+  free(recomb);
+  free(single);
+  free(secret);
+  return ok != 1;
+}
@@ -0,0 +1,182 @@
+/*
+ * This file is Copyright the libgfshare contributors 2026
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "libgfshare.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* A bump arena: what a service might keep per thread */
+typedef struct {
+  unsigned char* base;
+  size_t used;
+  size_t size;
+  unsigned int live;
+  int foreign;
+} arena;
+
+static void*
+arena_alloc( size_t size, size_t align, void* data )
+{
+  arena *a = data;
+  size_t start = (a->used + align - 1) & ~(align - 1);
+  if( start + size > a->size ) {
+    errno = ENOMEM;
+    return NULL;
+  }
+  a->used = start + size;
+  a->live++;
+  return a->base + start;
+}
+
+static void
+arena_free( void* ptr, size_t size, void* data )
+{
+  arena *a = data;
+  if( (unsigned char*)ptr < a->base ||
+      (unsigned char*)ptr + size > a->base + a->used )
+    a->foreign = 1; /* not one of ours */
+  a->live--;
+}
+
+#define BIGSIZE (1024 * 1024)
+
+/* Split and recombine with contexts carved from the arena, then check
+ * that everything came from (and went back to) the arena, that a keyed
+ * encoder's threads don't call the allocator at all once it is made, and
+ * that the built-in allocator still works for a context big enough to be
+ * mapped.
+ */
+int
+main( int argc, char **argv )
+{
+  unsigned char sharenrs[5] = { 1, 2, 3, 4, 5 };
+  unsigned char secret[1000], recomb[1000], sharebuf[5][1000];
+  unsigned char *shares[5], *bigsecret, *bigshares[5], *bigrecomb;
+  const unsigned char *bigslices[5];
+  size_t used;
+  gfshare_allocator allocator, previous;
+  gfshare_ctx *G;
+  arena a;
+  unsigned int i;
+  int ok = 1;
+
+  a.size = 4 << 20;
+  a.base = malloc( a.size + 64 );
+  a.base += 64 - ((size_t)a.base & 63);
+  a.used = 0;
+  a.live = 0;
+  a.foreign = 0;
+  allocator.alloc = arena_alloc;
+  allocator.free = arena_free;
+  allocator.data = &a;
+
+  allocator.free = NULL;
+  if( gfshare_set_allocator( &allocator ) == 0 || errno != EINVAL )
+    ok = 0;
+  allocator.free = arena_free;
+  if( gfshare_set_allocator( &allocator ) != 0 )
+    ok = 0;
+  gfshare_get_allocator( &previous );
+  if( previous.alloc != arena_alloc || previous.free != arena_free ||
+      previous.data != &a )
+    ok = 0;
+
+  for( i = 0; i < sizeof(secret); ++i )
+    secret[i] = (random() & 0xff00) >> 8;
+  for( i = 0; i < 5; ++i )
+    shares[i] = sharebuf[i];
+  G = gfshare_ctx_init_enc( sharenrs, 5, 3, sizeof(secret) );
+  if( G == NULL || a.live != 1 || ((size_t)G & 63) != 0 )
+    ok = 0;
+  gfshare_ctx_enc_setsecret( G, secret );
+  gfshare_ctx_enc_getshares( G, shares );
+  gfshare_ctx_free( G );
+
+  sharenrs[0] = sharenrs[3] = 0;
+  G = gfshare_ctx_init_dec( sharenrs, 5, 3, sizeof(secret) );
+  for( i = 0; i < 5; ++i )
+    gfshare_ctx_dec_giveshare( G, i, shares[i] );
+  gfshare_ctx_dec_extract( G, recomb );
+  if( memcmp( secret, recomb, sizeof(secret) ) != 0 )
+    ok = 0;
+  gfshare_ctx_free( G );
+  if( a.live != 0 || a.foreign || a.used == 0 ) {
+    fprintf( stderr, "arena: %u blocks still live, foreign %d\n",
+             a.live, a.foreign );
+    ok = 0;
+  }
+
+  bigsecret = malloc( BIGSIZE );
+  bigrecomb = malloc( BIGSIZE );
+  for( i = 0; i < BIGSIZE; ++i )
+    bigsecret[i] = (random() & 0xff00) >> 8;
+  for( i = 0; i < 5; ++i )
+    bigshares[i] = malloc( BIGSIZE );
+  sharenrs[0] = 1;
+  sharenrs[3] = 4;
+  G = gfshare_ctx_init_enc_keyed( sharenrs, 5, 3, BIGSIZE );
+  if( G == NULL ) {
+    perror( "gfshare_ctx_init_enc_keyed" );
+    return 1;
+  }
+  gfshare_ctx_set_threads( G, 4 );
+  gfshare_ctx_enc_setsecret( G, bigsecret );
+  used = a.used;
+  gfshare_ctx_enc_getshares( G, bigshares );
+  gfshare_ctx_enc_getshare( G, 4, bigshares[4] );
+  if( a.live != 1 || a.used != used ) {
+    fprintf( stderr, "keyed extraction called the allocator\n" );
+    ok = 0;
+  }
+  gfshare_ctx_free( G );
+  sharenrs[0] = sharenrs[3] = 0;
+  G = gfshare_ctx_init_dec( sharenrs, 5, 3, 1 );
+  for( i = 0; i < 5; ++i )
+    bigslices[i] = bigshares[i];
+  gfshare_ctx_dec_extract_shares( G, bigslices, bigrecomb, BIGSIZE );
+  gfshare_ctx_free( G );
+  if( memcmp( bigsecret, bigrecomb, BIGSIZE ) != 0 ) {
+    fprintf( stderr, "threaded keyed shares didn't recombine\n" );
+    ok = 0;
+  }
+  for( i = 0; i < 5; ++i )
+    free( bigshares[i] );
+  free( bigsecret );
+  free( bigrecomb );
+
+  /* Back to the built-in allocator, with a context over 2MiB */
+  gfshare_set_allocator( NULL );
+  a.used = 0;
+  G = gfshare_ctx_init_enc( sharenrs + 1, 2, 2, 4 * 1024 * 1024 );
+  if( G == NULL || a.used != 0 )
+    ok = 0;
+  else
+    gfshare_ctx_free( G );
+
+  return ok != 1;
+}
@@ -0,0 +1,181 @@
+/*
+ * This file is Copyright the libgfshare contributors 2026
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "libgfshare.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Split a batch of small secrets which runs over several context-sized
+ * chunks, and check that every secret recombines from its own slice of a
+ * different subset of the shares.
+ */
+
+#define SHARECOUNT 5
+#define THRESHOLD 3
+#define LENGTH 32
+#define COUNT 1001
+#define MAXSIZE 4096
+
+static int
+check_batch( int keyed )
+{
+  int ok = 1;
+  unsigned int i, n;
+  unsigned char sharenrs[SHARECOUNT] = { 9, 40, 77, 200, 255 };
+  unsigned char decnrs[SHARECOUNT];
+  unsigned char* secrets = malloc(COUNT * LENGTH);
+  unsigned char* shares[SHARECOUNT];
+  const unsigned char* slices[SHARECOUNT];
+  unsigned char recomb[LENGTH];
+  gfshare_ctx *G;
+
+  for( i = 0; i < COUNT * LENGTH; ++i )
+    secrets[i] = (random() & 0xff00) >> 8;
+  for( n = 0; n < SHARECOUNT; ++n )
+    shares[n] = malloc(COUNT * LENGTH);
+
+  if( keyed )
+    G = gfshare_ctx_init_enc_keyed( sharenrs, SHARECOUNT, THRESHOLD, MAXSIZE );
+  else
+    G = gfshare_ctx_init_enc( sharenrs, SHARECOUNT, THRESHOLD, MAXSIZE );
+  if( gfshare_ctx_enc_batch( G, secrets, COUNT, LENGTH, shares ) != 0 )
+    ok = 0;
+  gfshare_ctx_free( G );
+
+  for( i = 0; i < COUNT && ok; ++i ) {
+    /* Leave out a different pair of shares each time */
+    memcpy( decnrs, sharenrs, SHARECOUNT );
+    decnrs[i % SHARECOUNT] = 0;
+    decnrs[(i + 2) % SHARECOUNT] = 0;
+    for( n = 0; n < SHARECOUNT; ++n )
+      slices[n] = shares[n] + (i * LENGTH);
+    G = gfshare_ctx_init_dec( decnrs, SHARECOUNT, THRESHOLD, LENGTH );
+    gfshare_ctx_dec_extract_shares( G, slices, recomb, LENGTH );
+    gfshare_ctx_free( G );
+    if( memcmp( secrets + (i * LENGTH), recomb, LENGTH ) != 0 ) {
+      fprintf( stderr, "%s batch secret %u failed to recombine\n",
+               keyed ? "Keyed" : "Plain", i );
+      ok = 0;
+    }
+  }
+
+  for( n = 0; n < SHARECOUNT; ++n )
+    free(shares[n]);
+  free(secrets);
+  return ok;
+}
+
+/* More shares than there are share numbers can't be made, so batches never
+ * need more than 255 output pointers
+ */
+static int
+check_too_many( void )
+{
+  unsigned char sharenrs[256];
+  gfshare_ctx *G;
+  int keyed;
+
+  memset( sharenrs, 1, sizeof(sharenrs) );
+  for( keyed = 0; keyed < 2; ++keyed ) {
+    errno = 0;
+    G = keyed ? gfshare_ctx_init_enc_keyed( sharenrs, 256, THRESHOLD, LENGTH )
+              : gfshare_ctx_init_enc( sharenrs, 256, THRESHOLD, LENGTH );
+    if( G != NULL || errno != EINVAL ) {
+      fprintf( stderr, "%s encoder accepted 256 shares\n",
+               keyed ? "Keyed" : "Plain" );
+      if( G != NULL )
+        gfshare_ctx_free( G );
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/* A batch borrows the caller's secrets, so afterwards the context must be
+ * back on its own secret row; with an odd 'maxsize' the rows are padded and
+ * a miscomputed row would land in the coefficients.
+ */
+#define ODDSIZE 37
+
+static int
+check_secret_restored( int keyed )
+{
+  int ok = 1;
+  unsigned int i, n;
+  unsigned char sharenrs[SHARECOUNT] = { 9, 40, 77, 200, 255 };
+  unsigned char secret[ODDSIZE], recomb[ODDSIZE];
+  unsigned char* secrets = malloc(COUNT * ODDSIZE);
+  unsigned char* shares[SHARECOUNT];
+  gfshare_ctx *G, *D;
+
+  for( i = 0; i < ODDSIZE; ++i )
+    secret[i] = (random() & 0xff00) >> 8;
+  for( i = 0; i < COUNT * ODDSIZE; ++i )
+    secrets[i] = (random() & 0xff00) >> 8;
+  for( n = 0; n < SHARECOUNT; ++n )
+    shares[n] = malloc(COUNT * ODDSIZE);
+
+  if( keyed )
+    G = gfshare_ctx_init_enc_keyed( sharenrs, SHARECOUNT, THRESHOLD, ODDSIZE );
+  else
+    G = gfshare_ctx_init_enc( sharenrs, SHARECOUNT, THRESHOLD, ODDSIZE );
+  gfshare_ctx_enc_setsecret( G, secret );
+  if( gfshare_ctx_enc_batch( G, secrets, COUNT, ODDSIZE, shares ) != 0 )
+    ok = 0;
+
+  D = gfshare_ctx_init_dec( sharenrs, SHARECOUNT, THRESHOLD, ODDSIZE );
+  for( n = 0; n < SHARECOUNT; ++n ) {
+    gfshare_ctx_enc_getshare( G, n, shares[n] );
+    gfshare_ctx_dec_giveshare( D, n, shares[n] );
+  }
+  gfshare_ctx_dec_extract( D, recomb );
+  if( memcmp( secret, recomb, ODDSIZE ) != 0 ) {
+    fprintf( stderr, "%s encoder lost its secret after a batch\n",
+             keyed ? "Keyed" : "Plain" );
+    ok = 0;
+  }
+  gfshare_ctx_free( D );
+  gfshare_ctx_free( G );
+
+  for( n = 0; n < SHARECOUNT; ++n )
+    free(shares[n]);
+  free(secrets);
+  return ok;
+}
+
+int
+main( int argc, char **argv )
+{
+  int ok = 1;
+  ok &= check_batch( 0 );
+  ok &= check_batch( 1 );
+  ok &= check_secret_restored( 0 );
+  ok &= check_secret_restored( 1 );
+  ok &= check_too_many();
+  return ok != 1;
+}
@@ -0,0 +1,125 @@
+/*
+ * This file is Copyright the libgfshare contributors 2026
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "libgfshare.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Recombine a batch of secrets, each from a random subset of its shares.
+ * There are more subsets than the weight cache holds, and the batch is
+ * run twice so the second pass finds some of them cached. A job that
+ * repeats a share number fails the whole batch before it starts.
+ */
+
+#define SHARECOUNT 10
+#define THRESHOLD 3
+#define SIZE 97
+#define JOBS 500
+
+int
+main( int argc, char **argv )
+{
+  int ok = 1, pass;
+  unsigned int i, j, n;
+  unsigned char sharenrs[SHARECOUNT] = { 3, 17, 29, 64, 65, 100, 128, 190, 222, 254 };
+  unsigned char* jobnrs = malloc(JOBS * SHARECOUNT);
+  unsigned char* secrets = malloc(JOBS * SIZE);
+  unsigned char* recomb = malloc(JOBS * SIZE);
+  unsigned char* shares[SHARECOUNT];
+  const unsigned char* slices[JOBS][SHARECOUNT];
+  gfshare_dec_job jobs[JOBS];
+  gfshare_ctx *G;
+
+  for( i = 0; i < JOBS * SIZE; ++i )
+    secrets[i] = (random() & 0xff00) >> 8;
+  for( n = 0; n < SHARECOUNT; ++n )
+    shares[n] = malloc(JOBS * SIZE);
+  G = gfshare_ctx_init_enc( sharenrs, SHARECOUNT, THRESHOLD, JOBS * SIZE );
+  gfshare_ctx_enc_setsecret( G, secrets );
+  gfshare_ctx_enc_getshares( G, shares );
+  gfshare_ctx_free( G );
+
+  for( j = 0; j < JOBS; ++j ) {
+    /* Keep THRESHOLD shares picked at random */
+    unsigned char* nrs = jobnrs + (j * SHARECOUNT);
+    memset( nrs, 0, SHARECOUNT );
+    for( i = 0; i < THRESHOLD; ) {
+      n = random() % SHARECOUNT;
+      if( nrs[n] == 0 ) {
+        nrs[n] = sharenrs[n];
+        ++i;
+      }
+    }
+    for( n = 0; n < SHARECOUNT; ++n )
+      slices[j][n] = nrs[n] ? shares[n] + (j * SIZE) : NULL;
+    jobs[j].sharenrs = nrs;
+    jobs[j].shares = slices[j];
+    jobs[j].secretbuf = recomb + (j * SIZE);
+    jobs[j].size = SIZE;
+  }
+
+  G = gfshare_ctx_init_dec( sharenrs, SHARECOUNT, THRESHOLD, 1 );
+  for( pass = 0; pass < 2; ++pass ) {
+    memset( recomb, 0, JOBS * SIZE );
+    if( gfshare_ctx_dec_extract_batch( G, jobs, JOBS ) != 0 ) {
+      perror( "gfshare_ctx_dec_extract_batch" );
+      ok = 0;
+    }
+    for( j = 0; j < JOBS; ++j ) {
+      if( memcmp( secrets + (j * SIZE), recomb + (j * SIZE), SIZE ) != 0 ) {
+        fprintf( stderr, "Job %u failed to recombine on pass %d\n", j, pass );
+        ok = 0;
+      }
+    }
+  }
+
+  memset( recomb, 0, JOBS * SIZE );
+  jobnrs[(JOBS - 1) * SHARECOUNT] = 17;
+  jobnrs[(JOBS - 1) * SHARECOUNT + 1] = 17;
+  errno = 0;
+  if( gfshare_ctx_dec_extract_batch( G, jobs, JOBS ) == 0 ||
+      errno != EINVAL ) {
+    fprintf( stderr, "Batch with a repeated share number was accepted\n" );
+    ok = 0;
+  }
+  for( i = 0; i < SIZE; ++i ) {
+    if( recomb[i] != 0 ) {
+      fprintf( stderr, "Rejected batch recombined its first job\n" );
+      ok = 0;
+      break;
+    }
+  }
+  gfshare_ctx_free( G );
+
+  for( n = 0; n < SHARECOUNT; ++n )
+    free(shares[n]);
+  free(recomb);
+  free(secrets);
+  free(jobnrs);
+  return ok != 1;
+}
@@ -0,0 +1,98 @@
+/*
+ * This file is Copyright the libgfshare contributors 2026
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "libgfshare.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Check that gfshare_ctx_enc_getshares() produces exactly what calling
+ * gfshare_ctx_enc_getshare() for each share would, and that the result
+ * recombines, for a few shapes which straddle the tile boundaries.
+ */
+static int
+check_shape( unsigned int sharecount, unsigned int threshold,
+             unsigned int size )
+{
+  int ok = 1;
+  unsigned int i;
+  unsigned char* secret = malloc(size);
+  unsigned char* single = malloc(size);
+  unsigned char* recomb = malloc(size);
+  unsigned char* sharenrs = malloc(sharecount);
+  unsigned char** shares = malloc(sizeof(unsigned char*) * sharecount);
+  gfshare_ctx *G;
+
+  for( i = 0; i < size; ++i )
+    secret[i] = (random() & 0xff00) >> 8;
+  for( i = 0; i < sharecount; ++i ) {
+    sharenrs[i] = i + 1;
+    shares[i] = malloc(size);
+  }
+  G = gfshare_ctx_init_enc( sharenrs, sharecount, threshold, size );
+  gfshare_ctx_enc_setsecret( G, secret );
+  gfshare_ctx_enc_getshares( G, shares );
+  for( i = 0; i < sharecount; ++i ) {
+    gfshare_ctx_enc_getshare( G, i, single );
+    if( memcmp( single, shares[i], size ) != 0 )
+      ok = 0;
+  }
+  gfshare_ctx_free( G );
+
+  /* Recombine from the last 'threshold' shares */
+  for( i = 0; i < sharecount - threshold; ++i )
+    sharenrs[i] = 0;
+  G = gfshare_ctx_init_dec( sharenrs, sharecount, threshold, size );
+  for( i = 0; i < sharecount; ++i )
+    gfshare_ctx_dec_giveshare( G, i, shares[i] );
+  gfshare_ctx_dec_extract( G, recomb );
+  if( memcmp( secret, recomb, size ) != 0 )
+    ok = 0;
+  gfshare_ctx_free( G );
+
+  if( !ok )
+    fprintf( stderr, "getshares mismatch for %u-of-%u, %u bytes\n",
+             threshold, sharecount, size );
+  for( i = 0; i < sharecount; ++i )
+    free(shares[i]);
+  free(shares);
+  free(sharenrs);
+  free(recomb);
+  free(single);
+  free(secret);
+  return ok;
+}
+
+int
+main( int argc, char **argv )
+{
+  int ok = 1;
+  ok &= check_shape( 3, 2, 512 );
+  ok &= check_shape( 5, 1, 1 );
+  ok &= check_shape( 17, 17, 4097 );
+  ok &= check_shape( 255, 20, 70001 );
+  return ok != 1;
+}
@@ -0,0 +1,147 @@
+/*
+ * This file is Copyright the libgfshare contributors 2026
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+/* Check every multiply kernel this CPU can run against a naive
+ * log/exp multiplication, for every coefficient and a spread of lengths
+ * and alignments (so each kernel's tail handling gets exercised too).
+ */
+
+#include "gfshare_kernels.h"
+#include "gfshare_gf16.h"
+#include "libgfshare_tables.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAXLEN 300
+
+static unsigned char
+times( unsigned char a, unsigned char b )
+{
+  if( a == 0 || b == 0 )
+    return 0;
+  return exps[(logs[a] + logs[b]) % 255];
+}
+
+static unsigned short
+times16( unsigned short a, unsigned short b )
+{
+  if( a == 0 || b == 0 )
+    return 0;
+  return _gfshare_exps16[(_gfshare_logs16[a] + _gfshare_logs16[b]) %
+                         GFSHARE_GF16_ORDER];
+}
+
+static int
+check_kernel( const gfshare_kernel *kernel )
+{
+  unsigned char src[MAXLEN + 16], dst[MAXLEN + 16], ref[MAXLEN + 16];
+  unsigned int coeff, len, align, i;
+
+  for( coeff = 0; coeff < 256; ++coeff ) {
+    for( len = 0; len <= MAXLEN; len += (len < 130) ? 1 : 17 ) {
+      for( align = 0; align < 16; align += 5 ) {
+        for( i = 0; i < sizeof(src); ++i ) {
+          src[i] = (random() & 0xff00) >> 8;
+          dst[i] = ref[i] = (random() & 0xff00) >> 8;
+        }
+        for( i = 0; i < len; ++i )
+          ref[align + i] ^= times( coeff, src[align + i] );
+        kernel->muladd( dst + align, src + align, coeff, len );
+        if( memcmp( dst, ref, sizeof(dst) ) != 0 ) {
+          fprintf( stderr, "%s: mismatch (coeff=%u len=%u align=%u)\n",
+                   kernel->name, coeff, len, align );
+          return 0;
+        }
+      }
+    }
+  }
+  return 1;
+}
+
+/* The same for the gf(2**16) kernels, over the edge coefficients and a
+ * random sample of the rest
+ */
+static int
+check_kernel16( const gfshare_kernel *kernel )
+{
+  unsigned char src[MAXLEN + 16], dst[MAXLEN + 16], ref[MAXLEN + 16];
+  unsigned int n, coeff, len, align, i;
+  gfshare_mul16 mul;
+
+  for( n = 0; n < 600; ++n ) {
+    coeff = (n < 4) ? ((n & 1) ? 0xffff : n) : (random() & 0xffff);
+    _gfshare_mul16_prepare( coeff, &mul );
+    for( len = 0; len <= MAXLEN; len += (len < 130) ? 2 : 34 ) {
+      for( align = 0; align < 16; align += 5 ) {
+        for( i = 0; i < sizeof(src); ++i ) {
+          src[i] = (random() & 0xff00) >> 8;
+          dst[i] = ref[i] = (random() & 0xff00) >> 8;
+        }
+        for( i = 0; i < len; i += 2 ) {
+          unsigned short x = src[align + i] | (src[align + i + 1] << 8);
+          unsigned short y = times16( coeff, x );
+          ref[align + i] ^= y & 0xff;
+          ref[align + i + 1] ^= y >> 8;
+        }
+        kernel->muladd16( dst + align, src + align, &mul, len );
+        if( memcmp( dst, ref, sizeof(dst) ) != 0 ) {
+          fprintf( stderr, "%s: gf(2**16) mismatch (coeff=%u len=%u "
+                   "align=%u)\n", kernel->name, coeff, len, align );
+          return 0;
+        }
+      }
+    }
+  }
+  return 1;
+}
+
+int
+main( int argc, char **argv )
+{
+  const gfshare_kernel *kernel;
+  unsigned int i;
+  int ok = 1;
+
+  _gfshare_gf16_init();
+  /* The gf(2**16) tables must hit every nonzero element exactly once */
+  for( i = 0; i < GFSHARE_GF16_ORDER; ++i ) {
+    if( _gfshare_exps16[i] == 0 || _gfshare_logs16[_gfshare_exps16[i]] != i ) {
+      fprintf( stderr, "gf(2**16) tables are not a field\n" );
+      return 1;
+    }
+  }
+  for( kernel = _gfshare_kernels; kernel->name != NULL; ++kernel ) {
+    if( !kernel->supported() ) {
+      fprintf( stderr, "%s: not supported by this CPU, skipped\n",
+               kernel->name );
+      continue;
+    }
+    if( !check_kernel( kernel ) || !check_kernel16( kernel ) )
+      ok = 0;
+  }
+  return ok != 1;
+}
@@ -0,0 +1,131 @@
+/*
+ * This file is Copyright the libgfshare contributors 2026
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+
+#include "libgfshare.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Exercise keyed encoders: the shares must recombine, must come out the
+ * same again from a saved key, and the coefficients must be the ChaCha20
+ * keystream (so an all-zero secret and key, threshold 2, gives share 1 as
+ * the well-known all-zero-key keystream).
+ */
+
+#define SHARECOUNT 5
+#define THRESHOLD 3
+#define SIZE 100000
+
+static const unsigned char zero_key_stream[128] = {
+  0x76, 0xb8, 0xe0, 0xad, 0xa0, 0xf1, 0x3d, 0x90,
+  0x40, 0x5d, 0x6a, 0xe5, 0x53, 0x86, 0xbd, 0x28,
+  0xbd, 0xd2, 0x19, 0xb8, 0xa0, 0x8d, 0xed, 0x1a,
+  0xa8, 0x36, 0xef, 0xcc, 0x8b, 0x77, 0x0d, 0xc7,
+  0xda, 0x41, 0x59, 0x7c, 0x51, 0x57, 0x48, 0x8d,
+  0x77, 0x24, 0xe0, 0x3f, 0xb8, 0xd8, 0x4a, 0x37,
+  0x6a, 0x43, 0xb8, 0xf4, 0x15, 0x18, 0xa1, 0x1c,
+  0xc3, 0x87, 0xb6, 0x69, 0xb2, 0xee, 0x65, 0x86,
+  0x9f, 0x07, 0xe7, 0xbe, 0x55, 0x51, 0x38, 0x7a,
+  0x98, 0xba, 0x97, 0x7c, 0x73, 0x2d, 0x08, 0x0d,
+  0xcb, 0x0f, 0x29, 0xa0, 0x48, 0xe3, 0x65, 0x69,
+  0x12, 0xc6, 0x53, 0x3e, 0x32, 0xee, 0x7a, 0xed,
+  0x29, 0xb7, 0x21, 0x76, 0x9c, 0xe6, 0x4e, 0x43,
+  0xd5, 0x71, 0x33, 0xb0, 0x74, 0xd8, 0x39, 0xd5,
+  0x31, 0xed, 0x1f, 0x28, 0x51, 0x0a, 0xfb, 0x45,
+  0xac, 0xe1, 0x0a, 0x1f, 0x4b, 0x79, 0x4d, 0x6f };
+
+int
+main( int argc, char **argv )
+{
+  int ok = 1;
+  unsigned int i;
+  unsigned char sharenrs[SHARECOUNT] = { 1, 2, 3, 4, 5 };
+  unsigned char key[32];
+  unsigned char* secret = malloc(SIZE);
+  unsigned char* again = malloc(SIZE);
+  unsigned char* recomb = malloc(SIZE);
+  unsigned char* shares[SHARECOUNT];
+  gfshare_ctx *G;
+
+  for( i = 0; i < SIZE; ++i )
+    secret[i] = (random() & 0xff00) >> 8;
+  for( i = 0; i < SHARECOUNT; ++i )
+    shares[i] = malloc(SIZE);
+
+  /* Split, and keep the key */
+  G = gfshare_ctx_init_enc_keyed( sharenrs, SHARECOUNT, THRESHOLD, SIZE );
+  gfshare_ctx_enc_setsecret( G, secret );
+  gfshare_ctx_enc_getshares( G, shares );
+  gfshare_ctx_enc_getkey( G, key );
+  gfshare_ctx_free( G );
+
+  /* Recombine from shares 1, 3 and 5 */
+  sharenrs[1] = sharenrs[3] = 0;
+  G = gfshare_ctx_init_dec( sharenrs, SHARECOUNT, THRESHOLD, 1 );
+  gfshare_ctx_dec_extract_shares( G, (const unsigned char* const*)shares,
+                                  recomb, SIZE );
+  if( memcmp( secret, recomb, SIZE ) != 0 ) {
+    fprintf( stderr, "Keyed shares failed to recombine\n" );
+    ok = 0;
+  }
+  gfshare_ctx_free( G );
+
+  /* Regenerate share 4 from the saved key alone */
+  sharenrs[1] = 2; sharenrs[3] = 4;
+  G = gfshare_ctx_init_enc_keyed( sharenrs, SHARECOUNT, THRESHOLD, SIZE );
+  gfshare_ctx_enc_setsecret_nocopy( G, secret );
+  gfshare_ctx_enc_setkey( G, key );
+  gfshare_ctx_enc_getshare( G, 3, again );
+  if( memcmp( shares[3], again, SIZE ) != 0 ) {
+    fprintf( stderr, "Keyed share could not be regenerated\n" );
+    ok = 0;
+  }
+  gfshare_ctx_free( G );
+
+  /* The coefficients are the raw keystream */
+  memset( key, 0, sizeof(key) );
+  memset( secret, 0, sizeof(zero_key_stream) );
+  G = gfshare_ctx_init_enc_keyed( sharenrs, SHARECOUNT, 2,
+                                  sizeof(zero_key_stream) );
+  gfshare_ctx_enc_setsecret_nocopy( G, secret );
+  gfshare_ctx_enc_setkey( G, key );
+  gfshare_ctx_enc_getshare( G, 0, again );
+  if( memcmp( zero_key_stream, again, sizeof(zero_key_stream) ) != 0 ) {
+    fprintf( stderr, "Keyed coefficients are not the ChaCha20 keystream\n" );
+    ok = 0;
+  }
+  if( gfshare_ctx_enc_getkey( G, key ) != 0 )
+    ok = 0;
+  gfshare_ctx_free( G );
+
+  for( i = 0; i < SHARECOUNT; ++i )
+    free(shares[i]);
+  free(recomb);
+  free(again);
+  free(secret);
+  return ok != 1;
+}
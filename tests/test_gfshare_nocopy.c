@@ -0,0 +1,81 @@
+/*
+ * This file is Copyright the libgfshare contributors 2026
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+
+#include "libgfshare.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Split a secret the encoder reads in place, and recombine it from
+ * shares the decoder reads in place, including a length well beyond the
+ * decode context's maxsize.
+ */
+
+#define SHARECOUNT 4
+#define THRESHOLD 3
+#define SIZE 10000
+
+int
+main( int argc, char **argv )
+{
+  int ok = 1;
+  unsigned int i;
+  unsigned char sharenrs[SHARECOUNT] = { 9, 200, 31, 77 };
+  unsigned char* secret = malloc(SIZE);
+  unsigned char* recomb = malloc(SIZE);
+  unsigned char* shares[SHARECOUNT];
+  gfshare_ctx *G;
+
+  for( i = 0; i < SIZE; ++i )
+    secret[i] = (random() & 0xff00) >> 8;
+  for( i = 0; i < SHARECOUNT; ++i )
+    shares[i] = malloc(SIZE);
+
+  G = gfshare_ctx_init_enc( sharenrs, SHARECOUNT, THRESHOLD, SIZE );
+  gfshare_ctx_enc_setsecret_nocopy( G, secret );
+  gfshare_ctx_enc_getshares( G, shares );
+  gfshare_ctx_free( G );
+
+  /* Drop share 1 and hand the decoder a NULL for it */
+  sharenrs[1] = 0;
+  free(shares[1]);
+  shares[1] = NULL;
+  G = gfshare_ctx_init_dec( sharenrs, SHARECOUNT, THRESHOLD, 16 );
+  gfshare_ctx_dec_extract_shares( G, (const unsigned char* const*)shares,
+                                  recomb, SIZE );
+  if( memcmp( secret, recomb, SIZE ) != 0 ) {
+    fprintf( stderr, "In-place recombination failed\n" );
+    ok = 0;
+  }
+  gfshare_ctx_free( G );
+
+  for( i = 0; i < SHARECOUNT; ++i )
+    free(shares[i]);
+  free(recomb);
+  free(secret);
+  return ok != 1;
+}
@@ -0,0 +1,144 @@
+/*
+ * This file is Copyright the libgfshare contributors 2026
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "libgfshare.h"
+#include "gfshare_chacha.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+/* Check that the ChaCha20 keystream is the same however it is sliced up
+ * (long runs take the eight-block vector path where the CPU has one, short
+ * ones the scalar path), and that the built-in generator gives distinct
+ * output from call to call and across a fork.
+ */
+
+#define STREAM 8192
+
+static const unsigned char zero_key_block[16] = {
+  0x76, 0xb8, 0xe0, 0xad, 0xa0, 0xf1, 0x3d, 0x90,
+  0x40, 0x5d, 0x6a, 0xe5, 0x53, 0x86, 0xbd, 0x28 };
+
+static int
+check_slices( void )
+{
+  static const unsigned int offsets[] = { 0, 1, 63, 64, 100, 511, 512, 1000 };
+  static const unsigned int lengths[] = { 1, 64, 511, 512, 513, 2000, 4100 };
+  unsigned char key[GFSHARE_CHACHA_KEYLEN];
+  unsigned char *whole = malloc(STREAM), *part = malloc(STREAM);
+  unsigned int i, j;
+  int ok = 1;
+
+  memset( key, 0, sizeof(key) );
+  _gfshare_chacha20( key, 0, 0, whole, 1024 );
+  if( memcmp( whole, zero_key_block, sizeof(zero_key_block) ) != 0 ) {
+    fprintf( stderr, "ChaCha20 keystream does not match the test vector\n" );
+    ok = 0;
+  }
+
+  for( i = 0; i < sizeof(key); ++i )
+    key[i] = (random() & 0xff00) >> 8;
+  _gfshare_chacha20( key, 7, 0, whole, STREAM );
+  for( i = 0; i < sizeof(offsets) / sizeof(*offsets); ++i )
+    for( j = 0; j < sizeof(lengths) / sizeof(*lengths); ++j ) {
+      _gfshare_chacha20( key, 7, offsets[i], part, lengths[j] );
+      if( memcmp( whole + offsets[i], part, lengths[j] ) != 0 ) {
+        fprintf( stderr, "Keystream differs at offset %u, length %u\n",
+                 offsets[i], lengths[j] );
+        ok = 0;
+      }
+    }
+
+  /* The block counter must carry into its upper half mid-run */
+  _gfshare_chacha20( key, 7, 0xfffffffcULL * 64, whole, 1024 );
+  for( i = 0; i < 1024; i += 64 ) {
+    _gfshare_chacha20( key, 7, 0xfffffffcULL * 64 + i, part, 64 );
+    if( memcmp( whole + i, part, 64 ) != 0 ) {
+      fprintf( stderr, "Keystream differs across the counter carry\n" );
+      ok = 0;
+    }
+  }
+  free(part);
+  free(whole);
+  return ok;
+}
+
+static int
+check_generator( void )
+{
+  unsigned char a[STREAM], b[STREAM];
+  unsigned int sizes[] = { 1, 31, 32, 1000, 1024, STREAM };
+  unsigned int i;
+  int fds[2], status, ok = 1;
+  pid_t child;
+
+  for( i = 0; i < sizeof(sizes) / sizeof(*sizes); ++i ) {
+    gfshare_fill_rand( a, sizes[i] );
+    gfshare_fill_rand( b, sizes[i] );
+    if( sizes[i] >= 16 && memcmp( a, b, sizes[i] ) == 0 ) {
+      fprintf( stderr, "Generator repeated itself for %u bytes\n", sizes[i] );
+      ok = 0;
+    }
+  }
+
+  /* A forked child must not replay the parent's stream */
+  if( pipe( fds ) != 0 )
+    return 0;
+  child = fork();
+  if( child < 0 )
+    return 0;
+  if( child == 0 ) {
+    gfshare_fill_rand( a, 64 );
+    _exit( write( fds[1], a, 64 ) == 64 ? 0 : 1 );
+  }
+  gfshare_fill_rand( a, 64 );
+  if( read( fds[0], b, 64 ) != 64 || waitpid( child, &status, 0 ) != child ||
+      !WIFEXITED(status) || WEXITSTATUS(status) != 0 ) {
+    fprintf( stderr, "Forked child failed\n" );
+    ok = 0;
+  } else if( memcmp( a, b, 64 ) == 0 ) {
+    fprintf( stderr, "Forked child repeated the parent's random stream\n" );
+    ok = 0;
+  }
+  close( fds[0] );
+  close( fds[1] );
+  return ok;
+}
+
+int
+main( int argc, char **argv )
+{
+  int ok = 1;
+  if( gfshare_fill_rand != gfshare_fill_rand_chacha ) {
+    fprintf( stderr, "gfshare_fill_rand is not the built-in generator\n" );
+    ok = 0;
+  }
+  ok &= check_slices();
+  ok &= check_generator();
+  return ok != 1;
+}
@@ -0,0 +1,96 @@
+/*
+ * This file is Copyright the libgfshare contributors 2026
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "libgfshare.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define SECRET_SIZE 10000
+
+/* Recombine windows of a secret from just those bytes of each share, read
+ * back from files with pread(), and check them against the whole.
+ */
+int
+main( int argc, char **argv )
+{
+  static const unsigned int ranges[][2] = {
+    { 0, SECRET_SIZE }, { 0, 1 }, { 1, 63 }, { 4093, 4100 },
+    { SECRET_SIZE - 1, 1 }, { SECRET_SIZE, 0 }, { 777, 0 },
+  };
+  unsigned char sharenrs[5] = { 1, 2, 3, 4, 5 };
+  unsigned char secret[SECRET_SIZE], window[SECRET_SIZE + 1];
+  unsigned char sharebuf[5][SECRET_SIZE], *shares[5];
+  unsigned char readbuf[5][SECRET_SIZE];
+  const unsigned char *windows[5];
+  FILE *files[5];
+  gfshare_ctx *G;
+  unsigned int i, j;
+  int ok = 1;
+
+  for( i = 0; i < SECRET_SIZE; ++i )
+    secret[i] = (random() & 0xff00) >> 8;
+  for( i = 0; i < 5; ++i )
+    shares[i] = sharebuf[i];
+  G = gfshare_ctx_init_enc( sharenrs, 5, 3, SECRET_SIZE );
+  gfshare_ctx_enc_setsecret( G, secret );
+  gfshare_ctx_enc_getshares( G, shares );
+  gfshare_ctx_free( G );
+  for( i = 0; i < 5; ++i ) {
+    files[i] = tmpfile();
+    if( files[i] == NULL ||
+        fwrite( shares[i], 1, SECRET_SIZE, files[i] ) != SECRET_SIZE ||
+        fflush( files[i] ) != 0 )
+      return 1;
+  }
+
+  sharenrs[1] = sharenrs[3] = 0;
+  G = gfshare_ctx_init_dec( sharenrs, 5, 3, 1 );
+  for( i = 0; i < sizeof(ranges) / sizeof(*ranges); ++i ) {
+    unsigned int offset = ranges[i][0], length = ranges[i][1];
+    for( j = 0; j < 5; ++j ) {
+      windows[j] = NULL;
+      if( sharenrs[j] == 0 )
+        continue;
+      if( pread( fileno(files[j]), readbuf[j], length, offset ) !=
+          (ssize_t)length )
+        ok = 0;
+      windows[j] = readbuf[j];
+    }
+    memset( window, 0xa5, sizeof(window) );
+    gfshare_ctx_dec_extract_shares( G, windows, window, length );
+    if( memcmp( window, secret + offset, length ) != 0 ||
+        window[length] != 0xa5 ) {
+      fprintf( stderr, "range [%u, %u) failed\n", offset, offset + length );
+      ok = 0;
+    }
+  }
+  gfshare_ctx_free( G );
+  for( i = 0; i < 5; ++i )
+    fclose( files[i] );
+  return ok != 1;
+}
@@ -0,0 +1,284 @@
+/*
+ * This file is Copyright the libgfshare contributors 2026
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "libgfshare.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAXSIZE 8192
+#define LIVE 16
+
+/* Pass through to 'backing', counting allocations and checking that each
+ * block is freed with the size it was allocated with
+ */
+static gfshare_allocator backing;
+static unsigned int allocations;
+static struct { void* ptr; size_t size; } live[LIVE];
+static int misfreed = 0;
+
+static void*
+counting_alloc( size_t size, size_t align, void* data )
+{
+  void *ptr = backing.alloc( size, align, backing.data );
+  unsigned int i;
+  (void)data;
+  if( ptr == NULL )
+    return NULL;
+  allocations++;
+  for( i = 0; i < LIVE; ++i )
+    if( live[i].ptr == NULL ) {
+      live[i].ptr = ptr;
+      live[i].size = size;
+      break;
+    }
+  return ptr;
+}
+
+static void
+counting_free( void* ptr, size_t size, void* data )
+{
+  unsigned int i;
+  (void)data;
+  for( i = 0; i < LIVE; ++i )
+    if( live[i].ptr == ptr ) {
+      if( live[i].size != size ) {
+        fprintf( stderr, "block of %lu bytes freed as %lu\n",
+                 (unsigned long)live[i].size, (unsigned long)size );
+        misfreed = 1;
+        size = live[i].size;
+      }
+      live[i].ptr = NULL;
+      break;
+    }
+  backing.free( ptr, size, backing.data );
+}
+
+static void*
+heap_alloc( size_t size, size_t align, void* data )
+{
+  void *ptr;
+  (void)data;
+  if( posix_memalign( &ptr, align, size ) != 0 ) {
+    errno = ENOMEM;
+    return NULL;
+  }
+  return ptr;
+}
+
+static void
+heap_free( void* ptr, size_t size, void* data )
+{
+  (void)size;
+  (void)data;
+  free( ptr );
+}
+
+/* Grow an encoder from 'from' to 'to' bytes with 'with' behind the
+ * counting allocator, and check the old block went back whole; with the
+ * default allocator (NULL), a bad free aborts instead
+ */
+static int
+grow( const gfshare_allocator* with, unsigned int from, unsigned int to )
+{
+  unsigned char sharenrs[3] = { 1, 2, 3 };
+  gfshare_allocator counting;
+  gfshare_ctx *ctx, *moved;
+
+  counting.alloc = counting_alloc;
+  counting.free = counting_free;
+  counting.data = NULL;
+  if( with != NULL )
+    backing = *with;
+  gfshare_set_allocator( (with != NULL) ? &counting : NULL );
+  ctx = gfshare_ctx_init_enc( sharenrs, 3, 2, from );
+  if( ctx == NULL )
+    return -1;
+  moved = gfshare_ctx_reconfigure( ctx, sharenrs, 3, 2, to );
+  if( moved == NULL ) {
+    gfshare_ctx_free( ctx );
+    return -1;
+  }
+  gfshare_ctx_free( moved );
+  gfshare_set_allocator( NULL );
+  return !misfreed;
+}
+
+/* Split 'secret' with 'enc', recombine it with 'dec' from the first
+ * 'threshold' shares, and compare.
+ */
+static int
+roundtrip( gfshare_ctx* enc, gfshare_ctx* dec,
+           const unsigned char* sharenrs, unsigned int sharecount,
+           unsigned int threshold, const unsigned char* secret,
+           unsigned int size )
+{
+  static unsigned char sharebuf[16][MAXSIZE], recomb[MAXSIZE];
+  unsigned char decnrs[16];
+  unsigned int i;
+
+  if( gfshare_ctx_setsize( enc, size ) || gfshare_ctx_setsize( dec, size ) )
+    return 0;
+  gfshare_ctx_enc_setsecret( enc, secret );
+  for( i = 0; i < sharecount; ++i )
+    gfshare_ctx_enc_getshare( enc, i, sharebuf[i] );
+  for( i = 0; i < sharecount; ++i )
+    decnrs[i] = (i < threshold) ? sharenrs[i] : 0;
+  gfshare_ctx_dec_newshares( dec, decnrs );
+  for( i = 0; i < threshold; ++i )
+    gfshare_ctx_dec_giveshare( dec, i, sharebuf[i] );
+  gfshare_ctx_dec_extract( dec, recomb );
+  return memcmp( secret, recomb, size ) == 0;
+}
+
+/* Keep one encoder and one decoder across requests of different shapes,
+ * checking the results and that the contexts stop allocating once they
+ * have grown to the largest shape.
+ */
+int
+main( int argc, char **argv )
+{
+  static const struct { unsigned int count, threshold, maxsize; } shapes[] = {
+    { 3, 2, 512 }, { 16, 9, 4096 }, { 5, 3, 100 }, { 16, 16, MAXSIZE },
+    { 2, 2, 1 }, { 9, 4, 3000 },
+  };
+  unsigned char sharenrs[16], secret[MAXSIZE], recomb[MAXSIZE];
+  gfshare_allocator allocator;
+  gfshare_ctx *enc, *dec, *moved;
+  unsigned int i, round, grown = 0;
+  int ok = 1;
+
+  allocator.alloc = counting_alloc;
+  allocator.free = counting_free;
+  allocator.data = NULL;
+  backing.alloc = heap_alloc;
+  backing.free = heap_free;
+  backing.data = NULL;
+  gfshare_set_allocator( &allocator );
+
+  for( i = 0; i < sizeof(secret); ++i )
+    secret[i] = (random() & 0xff00) >> 8;
+  for( i = 0; i < 16; ++i )
+    sharenrs[i] = 16 - i;
+
+  enc = gfshare_ctx_init_enc( sharenrs, 2, 2, 1 );
+  dec = gfshare_ctx_init_dec( sharenrs, 2, 2, 1 );
+  if( enc == NULL || dec == NULL )
+    return 1;
+  /* a context can now work on a whole maxsize */
+  if( gfshare_ctx_setsize( enc, 1 ) != 0 || gfshare_ctx_setsize( enc, 2 ) == 0 )
+    ok = 0;
+
+  for( round = 0; round < 3; ++round ) {
+    for( i = 0; i < sizeof(shapes) / sizeof(*shapes); ++i ) {
+      moved = gfshare_ctx_reconfigure( enc, sharenrs, shapes[i].count,
+                                       shapes[i].threshold,
+                                       shapes[i].maxsize );
+      if( moved == NULL )
+        return 1;
+      enc = moved;
+      moved = gfshare_ctx_reconfigure( dec, sharenrs, shapes[i].count,
+                                       shapes[i].threshold,
+                                       shapes[i].maxsize );
+      if( moved == NULL )
+        return 1;
+      dec = moved;
+      if( !roundtrip( enc, dec, sharenrs, shapes[i].count,
+                      shapes[i].threshold, secret, shapes[i].maxsize ) ) {
+        fprintf( stderr, "round %u shape %u failed\n", round, i );
+        ok = 0;
+      }
+    }
+    if( round == 0 )
+      grown = allocations;
+  }
+  if( allocations != grown ) {
+    fprintf( stderr, "%u allocations after growing\n", allocations - grown );
+    ok = 0;
+  }
+
+  /* A rejected shape leaves the context as it was */
+  errno = 0;
+  if( gfshare_ctx_reconfigure( enc, sharenrs, 3, 4, 100 ) != NULL ||
+      errno != EINVAL )
+    ok = 0;
+  sharenrs[1] = 0;
+  if( gfshare_ctx_reconfigure( enc, sharenrs, 3, 2, 100 ) != NULL ||
+      errno != EINVAL )
+    ok = 0;
+  /* ...and decoders get the same checks as gfshare_ctx_init_dec() */
+  sharenrs[1] = sharenrs[2];
+  if( gfshare_ctx_reconfigure( dec, sharenrs, 3, 2, 100 ) != NULL ||
+      errno != EINVAL )
+    ok = 0;
+  if( gfshare_ctx_init_dec( sharenrs, 3, 2, 100 ) != NULL || errno != EINVAL )
+    ok = 0;
+  sharenrs[1] = 15;
+  if( !roundtrip( enc, dec, sharenrs, 9, 4, secret, 3000 ) )
+    ok = 0;
+
+  /* After a reset the size is back to maxsize and the shares are gone */
+  gfshare_ctx_setsize( dec, 10 );
+  gfshare_ctx_reset( dec );
+  memset( recomb, 0xff, sizeof(recomb) );
+  gfshare_ctx_dec_extract( dec, recomb );
+  for( i = 0; i < sizeof(recomb); ++i )
+    if( recomb[i] != ((i < 3000) ? 0 : 0xff) ) {
+      fprintf( stderr, "byte %u is %02x after reset\n", i, recomb[i] );
+      ok = 0;
+      break;
+    }
+  gfshare_ctx_reset( enc );
+  if( !roundtrip( enc, dec, sharenrs, 9, 4, secret, 3000 ) )
+    ok = 0;
+
+  gfshare_ctx_free( enc );
+  gfshare_ctx_free( dec );
+  if( misfreed )
+    ok = 0;
+
+  /* Moving a block the default allocator mmap()ed, past its 2MiB
+   * threshold, and one from the secure pool, frees each whole
+   */
+  if( grow( NULL, 4 << 20, 16 << 20 ) != 1 ) {
+    fprintf( stderr, "growing past the mmap threshold failed\n" );
+    ok = 0;
+  }
+  if( gfshare_secure_allocator( &allocator ) == 0 ) {
+    switch( grow( &allocator, 1000, 40000 ) ) {
+    case -1:
+      perror( "locked memory unavailable, secure pool skipped" );
+      break;
+    case 0:
+      fprintf( stderr, "growing in the secure pool failed\n" );
+      ok = 0;
+      break;
+    }
+    gfshare_secure_trim();
+  }
+  return ok != 1;
+}
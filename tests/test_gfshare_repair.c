@@ -0,0 +1,100 @@
+/*
+ * This file is Copyright the libgfshare contributors 2026
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "libgfshare.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SECRET_SIZE 10000
+#define SHARES 6
+
+/* Regenerate every share of a split from three of them, and check that
+ * each comes out the same as the share the encoder made.
+ */
+int
+main( int argc, char **argv )
+{
+  unsigned char sharenrs[SHARES] = { 1, 2, 3, 77, 200, 255 };
+  unsigned char secret[SECRET_SIZE], rebuilt[SECRET_SIZE];
+  unsigned char sharebuf[SHARES][SECRET_SIZE], *shares[SHARES];
+  const unsigned char *window[SHARES];
+  gfshare_ctx *G;
+  unsigned int i;
+  int ok = 1;
+
+  for( i = 0; i < SECRET_SIZE; ++i )
+    secret[i] = (random() & 0xff00) >> 8;
+  for( i = 0; i < SHARES; ++i )
+    shares[i] = sharebuf[i];
+  G = gfshare_ctx_init_enc( sharenrs, SHARES, 3, SECRET_SIZE );
+  gfshare_ctx_enc_setsecret( G, secret );
+  gfshare_ctx_enc_getshares( G, shares );
+  /* Only decoders interpolate */
+  if( gfshare_ctx_dec_settarget( G, 5 ) == 0 || errno != EINVAL )
+    ok = 0;
+  gfshare_ctx_free( G );
+
+  /* Keep shares 2, 77 and 255 */
+  sharenrs[0] = sharenrs[2] = sharenrs[4] = 0;
+  G = gfshare_ctx_init_dec( sharenrs, SHARES, 3, SECRET_SIZE );
+  for( i = 0; i < SHARES; ++i )
+    gfshare_ctx_dec_giveshare( G, i, shares[i] );
+  sharenrs[0] = 1;
+  sharenrs[2] = 3;
+  sharenrs[4] = 200;
+  /* Both the lost shares and those given come out right */
+  for( i = 0; i < SHARES; ++i ) {
+    gfshare_ctx_dec_settarget( G, sharenrs[i] );
+    gfshare_ctx_dec_extract( G, rebuilt );
+    if( memcmp( rebuilt, shares[i], SECRET_SIZE ) != 0 ) {
+      fprintf( stderr, "share %d was not rebuilt\n", sharenrs[i] );
+      ok = 0;
+    }
+  }
+  /* A range of a share is that range of the whole */
+  gfshare_ctx_dec_settarget( G, 200 );
+  for( i = 0; i < SHARES; ++i )
+    window[i] = shares[i] + 1234;
+  gfshare_ctx_dec_extract_shares( G, window, rebuilt, 4321 );
+  if( memcmp( rebuilt, shares[4] + 1234, 4321 ) != 0 )
+    ok = 0;
+  /* 0 and resetting both go back to the secret */
+  gfshare_ctx_dec_settarget( G, 0 );
+  gfshare_ctx_dec_extract( G, rebuilt );
+  if( memcmp( rebuilt, secret, SECRET_SIZE ) != 0 )
+    ok = 0;
+  gfshare_ctx_dec_settarget( G, 3 );
+  gfshare_ctx_reset( G );
+  for( i = 0; i < SHARES; ++i )
+    gfshare_ctx_dec_giveshare( G, i, shares[i] );
+  gfshare_ctx_dec_extract( G, rebuilt );
+  if( memcmp( rebuilt, secret, SECRET_SIZE ) != 0 )
+    ok = 0;
+  gfshare_ctx_free( G );
+  return ok != 1;
+}
@@ -0,0 +1,128 @@
+/*
+ * This file is Copyright the libgfshare contributors 2026
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "libgfshare.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SECRET_SIZE 10000
+#define TILE_SIZE 3000
+
+/* Reshare a 3-of-5 split as 4-of-7 a tile at a time, with a plain and a
+ * keyed encoder, and check that any four new shares (but not three) give
+ * the secret back.
+ */
+static int
+reshare_test( unsigned char* const* oldshares, const unsigned char* secret,
+              int keyed )
+{
+  unsigned char oldnrs[5] = { 1, 0, 3, 0, 5 };
+  unsigned char newnrs[7] = { 10, 20, 30, 40, 50, 60, 70 };
+  unsigned char sharebuf[7][SECRET_SIZE], *newshares[7], *tiles[7];
+  unsigned char *given[5], recovered[SECRET_SIZE];
+  gfshare_ctx *dec, *enc;
+  unsigned int offset, size, i;
+  int ok = 1;
+
+  dec = gfshare_ctx_init_dec( oldnrs, 5, 3, 1 );
+  if( keyed )
+    enc = gfshare_ctx_init_enc_keyed( newnrs, 7, 4, TILE_SIZE );
+  else
+    enc = gfshare_ctx_init_enc( newnrs, 7, 4, TILE_SIZE );
+  for( i = 0; i < 7; ++i )
+    newshares[i] = sharebuf[i];
+  for( offset = 0; offset < SECRET_SIZE; offset += size ) {
+    size = SECRET_SIZE - offset;
+    if( size > TILE_SIZE )
+      size = TILE_SIZE;
+    for( i = 0; i < 5; ++i )
+      given[i] = oldshares[i] + offset;
+    for( i = 0; i < 7; ++i )
+      tiles[i] = newshares[i] + offset;
+    if( gfshare_ctx_reshare( enc, dec, (const unsigned char* const*)given,
+                             tiles, size ) != 0 )
+      ok = 0;
+  }
+  /* Wrong way round, or too big a tile */
+  if( gfshare_ctx_reshare( dec, enc, (const unsigned char* const*)given,
+                           tiles, 1 ) == 0 || errno != EINVAL ||
+      gfshare_ctx_reshare( enc, dec, (const unsigned char* const*)given,
+                           tiles, TILE_SIZE + 1 ) == 0 )
+    ok = 0;
+  /* ...or a decoder interpolating to a share rather than the secret */
+  gfshare_ctx_dec_settarget( dec, 2 );
+  if( gfshare_ctx_reshare( enc, dec, (const unsigned char* const*)given,
+                           tiles, 1 ) == 0 || errno != EINVAL )
+    ok = 0;
+  gfshare_ctx_free( enc );
+  gfshare_ctx_free( dec );
+
+  newnrs[0] = newnrs[2] = newnrs[5] = 0;
+  dec = gfshare_ctx_init_dec( newnrs, 7, 4, 1 );
+  gfshare_ctx_dec_extract_shares( dec, (const unsigned char* const*)newshares,
+                                  recovered, SECRET_SIZE );
+  if( memcmp( recovered, secret, SECRET_SIZE ) != 0 ) {
+    fprintf( stderr, "four new shares didn't recombine (keyed %d)\n", keyed );
+    ok = 0;
+  }
+  gfshare_ctx_free( dec );
+  newnrs[1] = 0;
+  dec = gfshare_ctx_init_dec( newnrs, 7, 3, 1 );
+  gfshare_ctx_dec_extract_shares( dec, (const unsigned char* const*)newshares,
+                                  recovered, SECRET_SIZE );
+  if( memcmp( recovered, secret, SECRET_SIZE ) == 0 ) {
+    fprintf( stderr, "three new shares were enough (keyed %d)\n", keyed );
+    ok = 0;
+  }
+  gfshare_ctx_free( dec );
+  return ok;
+}
+
+int
+main( int argc, char **argv )
+{
+  unsigned char sharenrs[5] = { 1, 2, 3, 4, 5 };
+  unsigned char secret[SECRET_SIZE];
+  unsigned char sharebuf[5][SECRET_SIZE], *shares[5];
+  gfshare_ctx *G;
+  unsigned int i;
+  int ok = 1;
+
+  for( i = 0; i < SECRET_SIZE; ++i )
+    secret[i] = (random() & 0xff00) >> 8;
+  for( i = 0; i < 5; ++i )
+    shares[i] = sharebuf[i];
+  G = gfshare_ctx_init_enc( sharenrs, 5, 3, SECRET_SIZE );
+  gfshare_ctx_enc_setsecret( G, secret );
+  gfshare_ctx_enc_getshares( G, shares );
+  gfshare_ctx_free( G );
+
+  ok &= reshare_test( shares, secret, 0 );
+  ok &= reshare_test( shares, secret, 1 );
+  return ok != 1;
+}
@@ -0,0 +1,137 @@
+/*
+ * This file is Copyright the libgfshare contributors 2026
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "libgfshare.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define SIZE 10000
+
+static gfshare_allocator secure;
+static int unwiped = 0;
+
+/* Pass through to the secure pool, checking each block is wiped when
+ * freed. The pool keeps freed blocks mapped, so this is safe to look at;
+ * only the pool's own link at the start of the pages may be non-zero.
+ */
+static void*
+check_alloc( size_t size, size_t align, void* data )
+{
+  return secure.alloc( size, align, secure.data );
+}
+
+static void
+check_free( void* ptr, size_t size, void* data )
+{
+  size_t i, dirty = 0;
+  secure.free( ptr, size, secure.data );
+  for( i = 0; i < size; ++i )
+    if( ((unsigned char*)ptr)[i] != 0 )
+      ++dirty;
+  if( dirty > 2 * sizeof(void*) )
+    unwiped = 1;
+}
+
+int
+main( int argc, char **argv )
+{
+  unsigned char sharenrs[4] = { 10, 20, 30, 40 };
+  unsigned char secret[SIZE], recomb[SIZE], sharebuf[4][SIZE];
+  unsigned char *shares[4];
+  gfshare_allocator checked;
+  gfshare_ctx *G, *H;
+  unsigned int i;
+  int ok = 1;
+
+  if( gfshare_secure_allocator( &secure ) != 0 ) {
+    fprintf( stderr, "no secure pool on this system, skipped\n" );
+    return 77;
+  }
+  checked.alloc = check_alloc;
+  checked.free = check_free;
+  checked.data = NULL;
+  gfshare_set_allocator( &checked );
+
+  for( i = 0; i < SIZE; ++i )
+    secret[i] = (random() & 0xff00) >> 8;
+  for( i = 0; i < 4; ++i )
+    shares[i] = sharebuf[i];
+  G = gfshare_ctx_init_enc( sharenrs, 4, 3, SIZE );
+  if( G == NULL && (errno == EPERM || errno == ENOMEM || errno == EAGAIN) ) {
+    perror( "locked memory unavailable, skipped" );
+    return 77;
+  }
+  if( G == NULL )
+    return 1;
+  gfshare_ctx_enc_setsecret( G, secret );
+  gfshare_ctx_enc_getshares( G, shares );
+  gfshare_ctx_free( G );
+
+  /* A context the same shape gets the same, recycled, block */
+  H = gfshare_ctx_init_enc( sharenrs, 4, 3, SIZE );
+  if( H != G ) {
+    fprintf( stderr, "freed context was not recycled\n" );
+    ok = 0;
+  }
+  gfshare_ctx_free( H );
+
+  sharenrs[1] = 0;
+  G = gfshare_ctx_init_dec( sharenrs, 4, 3, SIZE );
+  for( i = 0; i < 4; ++i )
+    gfshare_ctx_dec_giveshare( G, i, shares[i] );
+  gfshare_ctx_dec_extract( G, recomb );
+  if( memcmp( secret, recomb, SIZE ) != 0 )
+    ok = 0;
+  gfshare_ctx_free( G );
+
+  /* Blocks end at the guard page, to within their alignment */
+  for( i = 0; i < 3 && ok; ++i ) {
+    static const size_t sizes[3] = { 8192, 1000, 1 };
+    size_t page = (size_t)sysconf( _SC_PAGESIZE ), size = sizes[i];
+    unsigned char *block = secure.alloc( size, 64, secure.data );
+    size_t slack;
+    if( block == NULL )
+      continue;
+    slack = (page - (((size_t)block + size) % page)) % page;
+    if( slack != (64 - (size % 64)) % 64 ) {
+      fprintf( stderr, "%u byte block ends %u bytes before its guard\n",
+               (unsigned int)size, (unsigned int)slack );
+      ok = 0;
+    }
+    secure.free( block, size, secure.data );
+  }
+
+  if( unwiped ) {
+    fprintf( stderr, "a freed block was not wiped\n" );
+    ok = 0;
+  }
+  gfshare_set_allocator( NULL );
+  gfshare_secure_trim();
+  return ok != 1;
+}
@@ -0,0 +1,132 @@
+/*
+ * This file is Copyright the libgfshare contributors 2026
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "libgfshare.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SIZE 4096
+
+static unsigned int begun[GFSHARE_PHASE_COUNT];
+static unsigned int ended[GFSHARE_PHASE_COUNT];
+
+static void
+hook( const gfshare_ctx* ctx, gfshare_phase phase, int end,
+      unsigned long long bytes, void* data )
+{
+  (*(unsigned int*)data)++;
+  if( end )
+    ended[phase]++;
+  else
+    begun[phase]++;
+}
+
+/* Check that the counters and hooks see each phase of a split and a
+ * recombination, or that they report ENOTSUP if the library was built
+ * without them.
+ */
+int
+main( int argc, char **argv )
+{
+  unsigned char sharenrs[3] = { 1, 2, 3 };
+  unsigned char secret[SIZE], recomb[SIZE], share0[SIZE], share1[SIZE];
+  unsigned char *shares[3];
+  unsigned int calls = 0, p;
+  gfshare_stats stats;
+  gfshare_ctx *G;
+  int ok = 1;
+
+  memset( secret, 0x5a, SIZE );
+  shares[0] = share0;
+  shares[1] = share1;
+  shares[2] = NULL;
+
+  G = gfshare_ctx_init_enc( sharenrs, 2, 2, SIZE );
+  if( gfshare_ctx_get_stats( G, &stats ) != 0 ) {
+    gfshare_ctx_free( G );
+    if( errno != ENOTSUP )
+      return 1;
+    fprintf( stderr, "statistics not configured in, skipped\n" );
+    return 77;
+  }
+  gfshare_ctx_set_hook( G, hook, &calls );
+  gfshare_ctx_enc_setsecret( G, secret );
+  gfshare_ctx_enc_getshares( G, shares );
+  gfshare_ctx_enc_getshare( G, 1, share1 );
+  gfshare_ctx_get_stats( G, &stats );
+  if( stats.phase[GFSHARE_PHASE_SETSECRET].calls != 1 ||
+      stats.phase[GFSHARE_PHASE_SETSECRET].bytes != SIZE ||
+      stats.phase[GFSHARE_PHASE_RAND].calls != 1 ||
+      stats.phase[GFSHARE_PHASE_RAND].bytes != SIZE ||
+      stats.phase[GFSHARE_PHASE_GETSHARE].calls != 2 ||
+      stats.phase[GFSHARE_PHASE_GETSHARE].bytes != 3 * SIZE ||
+      stats.phase[GFSHARE_PHASE_EXTRACT].calls != 0 ) {
+    fprintf( stderr, "encoder counters are wrong\n" );
+    ok = 0;
+  }
+  gfshare_ctx_reset_stats( G );
+  gfshare_ctx_get_stats( G, &stats );
+  for( p = 0; p < GFSHARE_PHASE_COUNT; ++p )
+    if( stats.phase[p].calls != 0 || stats.phase[p].ns != 0 )
+      ok = 0;
+  gfshare_ctx_free( G );
+
+  sharenrs[2] = 0;
+  G = gfshare_ctx_init_dec( sharenrs, 3, 2, SIZE );
+  gfshare_ctx_set_hook( G, hook, &calls );
+  gfshare_ctx_dec_giveshare( G, 0, share0 );
+  gfshare_ctx_dec_giveshare( G, 1, share1 );
+  gfshare_ctx_dec_extract( G, recomb );
+  sharenrs[2] = 3;
+  sharenrs[0] = 0;
+  gfshare_ctx_dec_newshares( G, sharenrs );
+  gfshare_ctx_get_stats( G, &stats );
+  if( memcmp( secret, recomb, SIZE ) != 0 ||
+      stats.phase[GFSHARE_PHASE_LAGRANGE].calls != 2 ||
+      stats.phase[GFSHARE_PHASE_GIVESHARE].calls != 2 ||
+      stats.phase[GFSHARE_PHASE_GIVESHARE].bytes != 2 * SIZE ||
+      stats.phase[GFSHARE_PHASE_EXTRACT].calls != 1 ||
+      stats.phase[GFSHARE_PHASE_EXTRACT].bytes != SIZE ) {
+    fprintf( stderr, "decoder counters are wrong\n" );
+    ok = 0;
+  }
+  gfshare_ctx_free( G );
+
+  /* Two calls per phase: setsecret, rand and two getshares, then two
+   * giveshares, an extract and a Lagrange pass (the decoder's first one
+   * ran before its hook was set)
+   */
+  if( calls != 2 * (4 + 4) ) {
+    fprintf( stderr, "hook called %u times\n", calls );
+    ok = 0;
+  }
+  for( p = 0; p < GFSHARE_PHASE_COUNT; ++p )
+    if( begun[p] != ended[p] )
+      ok = 0;
+  return ok != 1;
+}
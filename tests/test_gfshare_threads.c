@@ -0,0 +1,98 @@
+/*
+ * This file is Copyright the libgfshare contributors 2026
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "libgfshare.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Check that a context split across threads produces exactly the bytes
+ * the single-threaded context does, for a size which doesn't divide
+ * evenly between the workers.
+ */
+
+#define SHARECOUNT 5
+#define THRESHOLD 3
+#define SIZE (3 * 1024 * 1024 + 13)
+
+int
+main( int argc, char **argv )
+{
+  int ok = 1;
+  unsigned int i;
+  unsigned char sharenrs[SHARECOUNT] = { 1, 2, 3, 4, 5 };
+  unsigned char* secret = malloc(SIZE);
+  unsigned char* serial = malloc(SIZE);
+  unsigned char* parallel = malloc(SIZE);
+  unsigned char* shares[SHARECOUNT];
+  gfshare_ctx *G;
+
+  for( i = 0; i < SIZE; ++i )
+    secret[i] = (random() & 0xff00) >> 8;
+  for( i = 0; i < SHARECOUNT; ++i )
+    shares[i] = malloc(SIZE);
+
+  G = gfshare_ctx_init_enc( sharenrs, SHARECOUNT, THRESHOLD, SIZE );
+  gfshare_ctx_enc_setsecret( G, secret );
+  gfshare_ctx_enc_getshare( G, 1, serial );
+  if( gfshare_ctx_set_threads( G, 7 ) != 0 ) {
+    fprintf( stderr, "No thread support, nothing to test\n" );
+    return 77;
+  }
+  gfshare_ctx_enc_getshare( G, 1, parallel );
+  if( memcmp( serial, parallel, SIZE ) != 0 ) {
+    fprintf( stderr, "Threaded getshare differs\n" );
+    ok = 0;
+  }
+  gfshare_ctx_enc_getshares( G, shares );
+  if( memcmp( serial, shares[1], SIZE ) != 0 ) {
+    fprintf( stderr, "Threaded getshares differs\n" );
+    ok = 0;
+  }
+  gfshare_ctx_free( G );
+
+  sharenrs[1] = sharenrs[3] = 0;
+  G = gfshare_ctx_init_dec( sharenrs, SHARECOUNT, THRESHOLD, SIZE );
+  for( i = 0; i < SHARECOUNT; ++i )
+    gfshare_ctx_dec_giveshare( G, i, shares[i] );
+  gfshare_ctx_set_threads( G, 0 );
+  gfshare_ctx_dec_extract( G, serial );
+  gfshare_ctx_set_threads( G, 4 );
+  gfshare_ctx_dec_extract( G, parallel );
+  if( memcmp( secret, serial, SIZE ) != 0 ||
+      memcmp( secret, parallel, SIZE ) != 0 ) {
+    fprintf( stderr, "Threaded extract differs\n" );
+    ok = 0;
+  }
+  gfshare_ctx_free( G );
+
+  for( i = 0; i < SHARECOUNT; ++i )
+    free(shares[i]);
+  free(parallel);
+  free(serial);
+  free(secret);
+  return ok != 1;
+}
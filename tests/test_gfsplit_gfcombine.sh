@@ -42,5 +42,250 @@ to_test 0 1-3 "Three shares didn't succeed"
 to_test 0 2-4 "Three shares didn't succeed"
 to_test 0 3-5 "Three shares didn't succeed"
 
-exit 0
+# The mmap paths must agree with the stdio ones, across window boundaries
+dd if=/dev/urandom of=bigplain bs=1000 count=9000 2>/dev/null
+../gfsplit -M -n 2 -m 3 bigplain mapped
+MAPPED=$(ls mapped.* | xargs)
+../gfcombine -o unmapped $(echo $MAPPED | cut -d\  -f1-2)
+if ! cmp -s bigplain unmapped; then
+  echo "Memory-mapped split didn't recombine"
+  exit 1
+fi
+../gfcombine -M -o remapped $(echo $MAPPED | cut -d\  -f2-3)
+if ! cmp -s bigplain remapped; then
+  echo "Memory-mapped combine didn't succeed"
+  exit 1
+fi
+# Windows shrink with the share count, so many shares span several
+head -c 300000 bigplain > manyplain
+../gfsplit -M -m 255 -n 20 manyplain many
+if [ "$(ls many.* | wc -l | tr -d ' ')" != 255 ]; then
+  echo "Memory-mapped split didn't create 255 shares"
+  exit 1
+fi
+../gfcombine -o unmany $(ls many.* | head -n 20)
+if ! cmp -s manyplain unmany; then
+  echo "Memory-mapped split into 255 shares didn't recombine"
+  exit 1
+fi
+rm -f many.*
+# ...and so must the pipelined stdio split, which larger files go through
+../gfsplit -n 2 -m 3 bigplain piped
+PIPED=$(ls piped.* | xargs)
+../gfcombine -M -o unpiped $(echo $PIPED | cut -d\  -f1,3)
+if ! cmp -s bigplain unpiped; then
+  echo "Pipelined split didn't recombine"
+  exit 1
+fi
+# Standard input is streamed, with no length known up front
+cat bigplain | ../gfsplit -n 2 -m 3 - streamed
+STREAMED=$(ls streamed.* | xargs)
+../gfcombine -o unstreamed $(echo $STREAMED | cut -d\  -f2-3)
+if ! cmp -s bigplain unstreamed; then
+  echo "Streamed split didn't recombine"
+  exit 1
+fi
+../gfcombine -M -o - $(echo $SHARES | cut -d\  -f1-3) > tostdout
+if ! cmp -s plaintext tostdout; then
+  echo "Memory-mapped combine to stdout didn't succeed"
+  exit 1
+fi
+
+# Larger shares are read by a thread each, however deep the read-ahead
+for RA in 1 64; do
+  ../gfcombine -r $RA -o readahead $PIPED
+  if ! cmp -s bigplain readahead; then
+    echo "Combine with read-ahead $RA didn't succeed"
+    exit 1
+  fi
+done
+for RA in 4x ""; do
+  if ../gfcombine -r "$RA" -o readahead $PIPED 2>/dev/null; then
+    echo "Read-ahead '$RA' was accepted"
+    exit 1
+  fi
+done
+# ...and shares of different lengths are still caught
+head -c 5000000 $(echo $PIPED | cut -d\  -f1) > truncated.001
+if ../gfcombine -o readahead truncated.001 $(echo $PIPED | cut -d\  -f2) 2>/dev/null; then
+  echo "Combine of a truncated share didn't fail"
+  exit 1
+fi
+
+# Containers carry their own share numbers, threshold and checksums
+for MODE in "" -M; do
+  rm -f boxed.*
+  ../gfsplit $MODE -c -n 2 -m 3 bigplain boxed
+  BOXED=$(ls boxed.* | xargs)
+  if ! ../gfcombine -V $BOXED > verified; then
+    echo "Containers from gfsplit $MODE didn't verify"
+    exit 1
+  fi
+  for COMBINE in "" -M; do
+    ../gfcombine $COMBINE -o unboxed $(echo $BOXED | cut -d\  -f1,3)
+    if ! cmp -s bigplain unboxed; then
+      echo "Containers from gfsplit $MODE didn't combine with $COMBINE"
+      exit 1
+    fi
+  done
+done
+# ...so the filename doesn't matter, and too few shares are refused
+cp $(echo $BOXED | cut -d\  -f2) renamed
+if ../gfcombine -o unboxed renamed 2>/dev/null; then
+  echo "Combine of a single container didn't fail"
+  exit 1
+fi
+../gfcombine -o unboxed renamed $(echo $BOXED | cut -d\  -f3)
+if ! cmp -s bigplain unboxed; then
+  echo "Renamed container didn't combine"
+  exit 1
+fi
+# ...but without a .NNN to strip, the output must be named
+cp $(echo $BOXED | cut -d\  -f3) b
+for EXTRA in "" "-x 9" "-n 2 -m 3"; do
+  if ../gfcombine $EXTRA renamed b 2>/dev/null; then
+    echo "Combine of containers without .NNN names guessed an output ($EXTRA)"
+    exit 1
+  fi
+done
+rm -f b
+# A damaged block is found by -V, and stops a combine
+# (writing over a byte with something it isn't already)
+BYTE=$(dd if=renamed bs=1 skip=5000000 count=1 2>/dev/null | od -An -tu1 | tr -d ' ')
+if [ "$BYTE" = 88 ]; then DAMAGE=Y; else DAMAGE=X; fi
+printf $DAMAGE | dd of=renamed bs=1 seek=5000000 conv=notrunc 2>/dev/null
+if ../gfcombine -V renamed > verified; then
+  echo "Damaged container verified"
+  exit 1
+fi
+if ! grep -q "block 76 is damaged" verified; then
+  echo "Damaged container reported as: $(cat verified)"
+  exit 1
+fi
+for COMBINE in "" -M; do
+  if ../gfcombine $COMBINE -o unboxed renamed $(echo $BOXED | cut -d\  -f3) 2>/dev/null; then
+    echo "Damaged container combined with $COMBINE"
+    exit 1
+  fi
+done
+# A truncated container is reported as such, rather than read past its end
+head -c 5000000 $(echo $BOXED | cut -d\  -f1) > cut.box
+if ../gfcombine -V cut.box > verified; then
+  echo "Truncated container verified"
+  exit 1
+fi
+if ! grep -q "share is truncated" verified; then
+  echo "Truncated container reported as: $(cat verified)"
+  exit 1
+fi
+if ../gfcombine -o unboxed cut.box $(echo $BOXED | cut -d\  -f3) 2>/dev/null; then
+  echo "Truncated container combined"
+  exit 1
+fi
+# Streamed input gets a container too, once its length is known
+cat plaintext | ../gfsplit -c -n 3 -m 5 - streamedbox
+STREAMEDBOX=$(ls streamedbox.* | xargs)
+../gfcombine -V $STREAMEDBOX > verified
+../gfcombine -o unboxed $(echo $STREAMEDBOX | cut -d\  -f1-3)
+if ! cmp -s plaintext unboxed; then
+  echo "Streamed container didn't combine"
+  exit 1
+fi
+
+# Ranges come out the same as the same bytes of a whole combine
+range_test ()
+{
+  ../gfcombine --offset $1 --length $2 -o ranged $3 $4
+  dd if=bigplain of=expected bs=1 skip=$1 count=$2 2>/dev/null
+  if ! cmp -s expected ranged; then
+    echo "Range $1+$2 of $3 $4 didn't match"
+    exit 1
+  fi
+}
+for RANGE in "0 1" "65535 2" "1234567 345678" "8999999 1" "9000000 0" "8888888 200000"; do
+  range_test $RANGE $(echo $PIPED | cut -d\  -f1-2)
+  range_test $RANGE $(echo $BOXED | cut -d\  -f2-3)
+done
+# ...and only the blocks of a container the range touches are checked
+range_test 0 4000000 renamed $(echo $BOXED | cut -d\  -f3)
+if ../gfcombine --offset 4999999 --length 2 -o ranged renamed $(echo $BOXED | cut -d\  -f3) 2>/dev/null; then
+  echo "Range over a damaged block didn't fail"
+  exit 1
+fi
+
+# A lost share is rebuilt from the others exactly as gfsplit made it,
+# raw or as a container, and a rebuilt container checks out on its own
+for SHARES in "$PIPED" "$BOXED"; do
+  LOST=$(echo $SHARES | cut -d\  -f1)
+  NR=$(echo $LOST | sed 's/.*\.0*//')
+  for COMBINE in "" -M; do
+    ../gfcombine $COMBINE -x $NR -o rebuilt $(echo $SHARES | cut -d\  -f2-3)
+    if ! cmp -s $LOST rebuilt; then
+      echo "Share $LOST wasn't rebuilt with $COMBINE"
+      exit 1
+    fi
+  done
+done
+if ! ../gfcombine -V rebuilt > verified; then
+  echo "Rebuilt container didn't verify"
+  exit 1
+fi
+# ...a new share works with the old ones, and an existing one is refused
+../gfcombine -x 250 -o newshare.250 $(echo $PIPED | cut -d\  -f2-3)
+../gfcombine -o unpiped newshare.250 $(echo $PIPED | cut -d\  -f1)
+if ! cmp -s bigplain unpiped; then
+  echo "New share didn't combine with an old one"
+  exit 1
+fi
+NR=$(echo $PIPED | cut -d\  -f2 | sed 's/.*\.0*//')
+if ../gfcombine -x $NR -o rebuilt $(echo $PIPED | cut -d\  -f2-3) 2>/dev/null; then
+  echo "Rebuilding a share which was given didn't fail"
+  exit 1
+fi
+
+# Resharing makes a new set, to a new threshold, which recombines from
+# any threshold of its shares; containers stay containers
+for SHARES in "$PIPED" "$BOXED"; do
+  rm -f reshared.*
+  ../gfcombine -n 3 -m 4 -o reshared $(echo $SHARES | cut -d\  -f1,3)
+  RESHARED=$(ls reshared.* | xargs)
+  for PICK in 1-3 2-4 1,2,4; do
+    ../gfcombine -o unreshared $(echo $RESHARED | cut -d\  -f$PICK)
+    if ! cmp -s bigplain unreshared; then
+      echo "Reshare of $SHARES didn't recombine from $PICK"
+      exit 1
+    fi
+  done
+done
+if ! ../gfcombine -V $RESHARED > verified; then
+  echo "Reshared containers didn't verify"
+  exit 1
+fi
+if ../gfcombine -n 3 -m 4 -o reshared renamed $(echo $BOXED | cut -d\  -f3) 2>/dev/null; then
+  echo "Reshare of a damaged container didn't fail"
+  exit 1
+fi
 
+# Resharing next to the old set never touches a share that wasn't given,
+# and a failed reshare leaves nothing behind
+cp $(echo $PIPED | cut -d\  -f3) kept
+ls piped.* > before
+../gfcombine -n 2 -m 3 $(echo $PIPED | cut -d\  -f1-2)
+if ! cmp -s $(echo $PIPED | cut -d\  -f3) kept; then
+  echo "Reshare overwrote an old share"
+  exit 1
+fi
+ls piped.* > after
+if [ $(comm -13 before after | wc -l) -ne 3 ]; then
+  echo "Reshare beside the old set didn't make three new shares"
+  exit 1
+fi
+rm -f $(comm -13 before after)
+rm -f failed.*
+../gfcombine -n 3 -m 4 -o failed renamed $(echo $BOXED | cut -d\  -f3) 2>/dev/null
+if ls failed.* > /dev/null 2>&1; then
+  echo "Failed reshare left files behind"
+  exit 1
+fi
+
+exit 0
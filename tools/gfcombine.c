@@ -5,14 +5,33 @@
 #include "config.h"
 
 #include <unistd.h>
+#include <getopt.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#if defined(HAVE_SYS_MMAN_H) && defined(HAVE_MMAP)
+#include <sys/mman.h>
+#define GFCOMBINE_MMAP 1
+#endif
+
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
 
 #include "libgfshare.h"
+#include "gfshare_file.h"
 
 #define BUFFER_SIZE 4096
+/* How much of each share is mapped and combined at once with -M */
+#define MMAP_WINDOW (8 * 1024 * 1024)
 
 #ifndef MIN
 #define MIN(a,b) ((a)<(b))?(a):(b)
@@ -24,26 +43,32 @@ void
 usage(FILE* stream)
 {
   fprintf( stream, "\
-Usage: %s [-o outputfile] inputfile inputfile2...\n\
+Usage: %s [-o outputfile] [-M] [-r readahead] [-x sharenr] inputfile inputfile2...\n\
+       %s [-o outputfile] --offset n --length n inputfile inputfile2...\n\
+       %s -n threshold -m sharecount [-o outputstem] inputfile inputfile2...\n\
+       %s -V inputfile...\n\
   where outputfile is the filename to write the combined result to.\n\
+  where -M memory-maps the shares instead of reading them through stdio.\n\
+  where readahead is how many blocks to read ahead of the recombination\n\
+    from each share, each share being read by its own thread.\n\
+  where --offset and --length recombine only that many bytes from that\n\
+    offset, reading only that part of each share.\n\
+  where sharenr is a share to rebuild from the others instead of the\n\
+    original file, which is never itself formed.\n\
+  where threshold and sharecount reshare the input into a new set of\n\
+    sharecount shares, any threshold of which recombine, written to\n\
+    outputstem.NNN without the original file ever being formed.\n\
+  where -V checks each share container against its checksums instead.\n\
   where inputfile[2...] are the shares to recombine.\n\
 \n\
 If outputfile is not provided, it is automatically created by stripping the\n\
-last four characters off the first input file name.\n\
+\".NNN\" off the first input file name (and, with -x, adding the new share\n\
+number), which must then end in one.\n\
 \n\
 Each input file must be the same length and the filenames must end in a\n\
 number which will be taken to be the share number. I.E. \".NNN\".\n\
-", progname );
-}
-
-static unsigned int
-getlen( FILE* f )
-{
-  unsigned int len;
-  fseek(f, 0, SEEK_END);
-  len = ftell(f);
-  fseek(f, 0, SEEK_SET);
-  return len;
+Share containers (from gfsplit -c) carry their own share number instead.\n\
+", progname, progname, progname, progname );
 }
 
 static void
@@ -58,6 +83,17 @@ zero_filename( char* fname )
   fprintf( stderr, "%s: %s: input files <name>.000 don't work, see README\n", progname, fname );
 }
 
+/* Whether 'fname' ends in a share number, I.E. ".NNN" */
+static int
+has_share_suffix( const char* fname )
+{
+  size_t nlen = strlen(fname);
+  return nlen >= 5 && fname[nlen-4] == '.' &&
+    isdigit((unsigned char)fname[nlen-3]) &&
+    isdigit((unsigned char)fname[nlen-2]) &&
+    isdigit((unsigned char)fname[nlen-1]);
+}
+
 static int
 check_filenames( char **filenames, int count )
 {
@@ -68,14 +104,10 @@ check_filenames( char **filenames, int count )
   }
   for( i = 0; i < count; ++i ) {
     int nlen = strlen(filenames[i]);
-    if( nlen < 5 ) {
-      bad_filename(filenames[i]);
-      return 1;
-    }
-    if( filenames[i][nlen-4] != '.' ||
-        !isdigit(filenames[i][nlen-3]) ||
-        !isdigit(filenames[i][nlen-2]) ||
-        !isdigit(filenames[i][nlen-1]) ) {
+    /* Containers carry their own share number */
+    if( gfshare_file_is_container( filenames[i] ) )
+      continue;
+    if( !has_share_suffix(filenames[i]) ) {
       bad_filename(filenames[i]);
       return 1;
     }
@@ -89,22 +121,515 @@ check_filenames( char **filenames, int count )
   return 0;
 }
 
+/* What is known about the shares being combined. Raw shares only carry
+ * their number, in the filename. Containers say it themselves, along
+ * with the threshold and length, and have a checksum for every block to
+ * check the share against as it is read.
+ */
+typedef struct {
+  int container;
+  unsigned char* sharenrs;
+  unsigned int threshold; /* for containers */
+  uint64_t length;        /* of each share; UINT64_MAX if not known */
+  off_t base;             /* where each share starts in its file */
+  gfshare_index* checks;  /* per share, for containers */
+  unsigned char target;   /* with -x, the share to rebuild; otherwise 0 */
+  gfshare_index rebuilt;  /* the index of a rebuilt container */
+} gfcombine_shares;
+
+/* Work out the share numbers and length of the open shares 'fds' */
+static int
+describe_shares( gfcombine_shares* shares, char **filenames, int* fds,
+                 int count )
+{
+  gfshare_file_header header, first;
+  struct stat st;
+  uint32_t *crcs;
+  uint64_t ncrcs;
+  int i, j;
+
+  memset( &header, 0, sizeof(header) );
+  memset( &first, 0, sizeof(first) );
+  memset( shares, 0, sizeof(*shares) );
+  shares->sharenrs = malloc( count );
+  shares->checks = malloc( sizeof(gfshare_index) * count );
+  if( shares->sharenrs == NULL || shares->checks == NULL ) {
+    perror( "malloc" );
+    return 1;
+  }
+  for( i = 0; i < count; ++i ) {
+    int container = gfshare_file_read_header( fds[i], &header ) == 0;
+    if( !container && errno == ENOTSUP ) {
+      fprintf( stderr, "%s: %s: made by a newer gfsplit\n", progname, filenames[i] );
+      return 1;
+    }
+    if( !container && errno == EFBIG ) {
+      fprintf( stderr, "%s: %s: share is truncated\n", progname, filenames[i] );
+      return 1;
+    }
+    if( i == 0 ) {
+      shares->container = container;
+      first = header;
+    } else if( container != shares->container ) {
+      fprintf( stderr, "%s: Can't combine containers with raw shares.\n", progname );
+      return 1;
+    }
+    if( !container ) {
+      shares->sharenrs[i] = strtoul( filenames[i] + strlen(filenames[i]) - 3,
+                                     NULL, 10 );
+      if( fstat( fds[i], &st ) != 0 ) {
+        perror(filenames[i]);
+        return 1;
+      }
+      header.length = S_ISREG(st.st_mode) ? (uint64_t)st.st_size : UINT64_MAX;
+    } else {
+      shares->sharenrs[i] = header.sharenr;
+      if( header.threshold != first.threshold ||
+          header.blocksize != first.blocksize ) {
+        fprintf( stderr, "%s: %s: not from the same split as %s\n", progname,
+                 filenames[i], filenames[0] );
+        return 1;
+      }
+      if( gfshare_file_read_index( fds[i], &header, &crcs, &ncrcs ) ) {
+        fprintf( stderr, "%s: %s: index is damaged\n", progname, filenames[i] );
+        return 1;
+      }
+      gfshare_index_init( &shares->checks[i], header.blocksize, crcs, ncrcs );
+    }
+    if( i == 0 )
+      shares->length = header.length;
+    else if( shares->length != header.length ) {
+      fprintf( stderr, "%s: File length mismatch between input files.\n", progname );
+      return 1;
+    }
+    for( j = 0; j < i; ++j )
+      if( shares->sharenrs[j] == shares->sharenrs[i] ) {
+        fprintf( stderr, "%s: %s: share %d is given twice\n", progname,
+                 filenames[i], shares->sharenrs[i] );
+        return 1;
+      }
+  }
+  if( shares->container ) {
+    shares->base = GFSHARE_FILE_HEADER;
+    shares->threshold = first.threshold;
+    if( count < first.threshold ) {
+      fprintf( stderr, "%s: %d shares given, but %d are needed\n", progname,
+               count, first.threshold );
+      return 1;
+    }
+  } else {
+    free( shares->checks );
+    shares->checks = NULL;
+  }
+  return 0;
+}
+
+/* Check the next 'len' bytes of share 'i' against its container */
+static int
+check_share( gfcombine_shares* shares, int i, const char* filename,
+             const unsigned char* data, unsigned int len )
+{
+  gfshare_index *check;
+  if( shares->checks == NULL )
+    return 0;
+  check = &shares->checks[i];
+  if( gfshare_index_update( check, data, len ) ) {
+    perror( "malloc" );
+    return 1;
+  }
+  if( check->bad >= 0 ) {
+    fprintf( stderr, "%s: %s: block %lu is damaged\n", progname, filename,
+             (unsigned long)check->bad );
+    return 1;
+  }
+  return 0;
+}
+
+/* Once every share has been read, check nothing was missing */
+static int
+finish_shares( gfcombine_shares* shares, char **filenames, int count )
+{
+  int i;
+  if( shares->checks == NULL )
+    return 0;
+  for( i = 0; i < count; ++i ) {
+    if( gfshare_index_finish( &shares->checks[i] ) == 0 &&
+        shares->checks[i].bad >= 0 ) {
+      fprintf( stderr, "%s: %s: block %lu is damaged\n", progname, filenames[i],
+               (unsigned long)shares->checks[i].bad );
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/* A share can only be rebuilt from others; checked before the output,
+ * which might otherwise be the very same file, is opened.
+ */
+static int
+check_target( gfcombine_shares* shares, char **filenames, int count,
+              unsigned char target )
+{
+  int i;
+  for( i = 0; i < count && target != 0; ++i ) {
+    if( shares->sharenrs[i] == target ) {
+      fprintf( stderr, "%s: %s: already is share %d\n", progname,
+               filenames[i], target );
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/* Start a decoder for the shares, interpolating to the share being
+ * rebuilt if there is one. A share rebuilt from containers is written as a
+ * container too, so room is left for its header in 'outfd'.
+ */
+static gfshare_ctx*
+start_decoder( gfcombine_shares* shares, int count, unsigned char target,
+               char *outputfilename, int outfd )
+{
+  gfshare_ctx *G;
+
+  if( target != 0 && shares->container ) {
+    if( lseek( outfd, GFSHARE_FILE_HEADER, SEEK_SET ) < 0 ) {
+      perror(outputfilename);
+      return NULL;
+    }
+    gfshare_index_init( &shares->rebuilt, GFSHARE_FILE_BLOCK, NULL, 0 );
+  }
+  shares->target = target;
+  G = gfshare_ctx_init_dec( shares->sharenrs, count, count, 1 );
+  if( !G ) {
+    perror("gfshare_ctx_init_dec");
+    return NULL;
+  }
+  gfshare_ctx_dec_settarget( G, target );
+  return G;
+}
+
+/* Checksum the next 'len' bytes written of a rebuilt container */
+static int
+note_output( gfcombine_shares* shares, const unsigned char* data,
+             unsigned int len )
+{
+  if( shares->target == 0 || !shares->container )
+    return 0;
+  if( gfshare_index_update( &shares->rebuilt, data, len ) ) {
+    perror( "malloc" );
+    return 1;
+  }
+  return 0;
+}
+
+/* Close off a container of 'length' bytes once all of it has been
+ * written: its index goes after the share, then its header before it.
+ */
+static int
+finish_container( int fd, unsigned char sharenr, unsigned int threshold,
+                  uint64_t length, gfshare_index *index )
+{
+  gfshare_file_header header;
+  header.sharenr = sharenr;
+  header.threshold = threshold;
+  header.field = GFSHARE_FILE_FIELD8;
+  header.blocksize = index->blocksize;
+  header.length = length;
+  if( gfshare_index_finish( index ) ||
+      gfshare_file_write_index( fd, &header, index ) ||
+      gfshare_file_write_header( fd, &header ) )
+    return 1;
+  gfshare_index_free( index );
+  return 0;
+}
+
+/* Close off a rebuilt container once all of it has been written */
+static int
+finish_output( gfcombine_shares* shares, char *outputfilename, int outfd )
+{
+  gfshare_index *index = &shares->rebuilt;
+  if( shares->target == 0 || !shares->container )
+    return 0;
+  if( finish_container( outfd, shares->target, shares->threshold,
+                        (index->count * index->blocksize) + index->filled,
+                        index ) ) {
+    perror(outputfilename);
+    return 1;
+  }
+  return 0;
+}
+
+#ifdef HAVE_PTHREAD_H
+/* The pipelined combiner: a reader thread per share file fills a ring of
+ * blocks ahead of the main thread, which recombines block N once every
+ * share's copy of it has arrived. Slow or distant sources are then read
+ * at the same time rather than one after another, so a run takes about
+ * as long as the slowest of them.
+ */
+#define DEFAULT_READAHEAD 4
+#define MAX_READAHEAD 64
+/* Memory for all the rings' buffers, and the most any one block gets */
+#define PIPELINE_BUDGET (32 * 1024 * 1024)
+#define PIPELINE_BLOCK_MAX (1024 * 1024)
+
+typedef struct {
+  pthread_mutex_t lock;
+  pthread_cond_t changed;
+  unsigned int blocksize;
+  unsigned int depth;       /* blocks in each share's ring */
+  unsigned char ***rings;   /* per share, 'depth' blocks */
+  unsigned int **lengths;   /* per share, the length of each ring block */
+  unsigned long *nread;     /* blocks read so far, per share */
+  int *eof;                 /* per share, nothing more to read */
+  unsigned long nconsumed;  /* blocks recombined so far */
+  int failed;
+  FILE **inputfiles;
+  char **inputfilenames;
+  gfcombine_shares *shares;
+} gfcombine_pipeline;
+
+typedef struct {
+  gfcombine_pipeline *p;
+  unsigned int share;
+} gfcombine_reader;
+
+static unsigned int
+pipeline_blocksize( unsigned int filecount, unsigned int depth )
+{
+  unsigned int size = PIPELINE_BUDGET / (depth * filecount + 1);
+  size &= ~(BUFFER_SIZE - 1);
+  if( size < BUFFER_SIZE ) return BUFFER_SIZE;
+  if( size > PIPELINE_BLOCK_MAX ) return PIPELINE_BLOCK_MAX;
+  return size;
+}
+
+static void*
+pipeline_reader( void* arg )
+{
+  gfcombine_reader *r = arg;
+  gfcombine_pipeline *p = r->p;
+  unsigned long block;
+  int damaged;
+
+  for( block = 0; ; ++block ) {
+    unsigned int slot = block % p->depth, length, want = p->blocksize;
+    uint64_t offset = (uint64_t)block * p->blocksize;
+    /* Wait for the block last in this slot to be recombined */
+    pthread_mutex_lock( &p->lock );
+    while( !p->failed && block - p->nconsumed >= p->depth )
+      pthread_cond_wait( &p->changed, &p->lock );
+    if( p->failed ) {
+      pthread_mutex_unlock( &p->lock );
+      return NULL;
+    }
+    pthread_mutex_unlock( &p->lock );
+
+    /* A container's index follows the share */
+    if( offset >= p->shares->length )
+      want = 0;
+    else if( p->shares->length - offset < want )
+      want = p->shares->length - offset;
+    length = 0;
+    if( want > 0 )
+      length = fread( p->rings[r->share][slot], 1, want,
+                      p->inputfiles[r->share] );
+    if( ferror(p->inputfiles[r->share]) ) {
+      perror( p->inputfilenames[r->share] );
+      damaged = 1;
+    } else {
+      damaged = check_share( p->shares, r->share,
+                             p->inputfilenames[r->share],
+                             p->rings[r->share][slot], length );
+    }
+
+    pthread_mutex_lock( &p->lock );
+    p->lengths[r->share][slot] = length;
+    if( damaged ) {
+      p->failed = 1;
+    } else if( length == 0 ) {
+      p->eof[r->share] = 1;
+    } else {
+      p->nread[r->share] = block + 1;
+    }
+    pthread_cond_broadcast( &p->changed );
+    if( p->failed || p->eof[r->share] ) {
+      pthread_mutex_unlock( &p->lock );
+      return NULL;
+    }
+    pthread_mutex_unlock( &p->lock );
+  }
+}
+
 static int
-do_gfcombine( char *outputfilename, char **inputfilenames, int filecount )
+combine_pipelined( gfshare_ctx *G, FILE **inputfiles, char **inputfilenames,
+                   gfcombine_shares *shares, unsigned int filecount,
+                   FILE *outfile, unsigned int depth )
+{
+  gfcombine_pipeline p;
+  gfcombine_reader *readers = malloc( sizeof(gfcombine_reader) * filecount );
+  pthread_t *threads = malloc( sizeof(pthread_t) * filecount );
+  const unsigned char **blocks = malloc( sizeof(unsigned char*) * filecount );
+  unsigned char *buffer;
+  unsigned long block;
+  unsigned int i, j, started = 0;
+  int failed = 0;
+
+  memset( &p, 0, sizeof(p) );
+  p.blocksize = pipeline_blocksize( filecount, depth );
+  p.depth = depth;
+  p.rings = malloc( sizeof(unsigned char**) * filecount );
+  p.lengths = malloc( sizeof(unsigned int*) * filecount );
+  p.nread = calloc( filecount, sizeof(unsigned long) );
+  p.eof = calloc( filecount, sizeof(int) );
+  buffer = malloc( p.blocksize );
+  if( readers == NULL || threads == NULL || blocks == NULL ||
+      p.rings == NULL || p.lengths == NULL || p.nread == NULL ||
+      p.eof == NULL || buffer == NULL ) {
+    perror( "malloc" );
+    return 1;
+  }
+  for( i = 0; i < filecount; ++i ) {
+    p.rings[i] = malloc( sizeof(unsigned char*) * depth );
+    p.lengths[i] = malloc( sizeof(unsigned int) * depth );
+    if( p.rings[i] == NULL || p.lengths[i] == NULL ) {
+      perror( "malloc" );
+      return 1;
+    }
+    for( j = 0; j < depth; ++j ) {
+      p.rings[i][j] = malloc( p.blocksize );
+      if( p.rings[i][j] == NULL ) {
+        perror( "malloc" );
+        return 1;
+      }
+    }
+  }
+  pthread_mutex_init( &p.lock, NULL );
+  pthread_cond_init( &p.changed, NULL );
+  p.inputfiles = inputfiles;
+  p.inputfilenames = inputfilenames;
+  p.shares = shares;
+
+  for( i = 0; i < filecount; ++i ) {
+    readers[i].p = &p;
+    readers[i].share = i;
+    if( pthread_create( &threads[i], NULL, pipeline_reader,
+                        &readers[i] ) != 0 ) {
+      pthread_mutex_lock( &p.lock );
+      p.failed = 1;
+      pthread_cond_broadcast( &p.changed );
+      pthread_mutex_unlock( &p.lock );
+      fprintf( stderr, "%s: Unable to start the reader threads\n", progname );
+      break;
+    }
+    started = i + 1;
+  }
+  /* Blocks are big enough to be worth sharing between the CPUs */
+  gfshare_ctx_set_threads( G, 0 );
+
+  for( block = 0; ; ++block ) {
+    unsigned int slot = block % depth, length, ready, ended, bytes_written;
+    pthread_mutex_lock( &p.lock );
+    for( ;; ) {
+      ready = ended = 0;
+      for( i = 0; i < filecount; ++i ) {
+        if( p.nread[i] > block ) ready++;
+        else if( p.eof[i] ) ended++;
+      }
+      if( p.failed || ready + ended == filecount ) break;
+      pthread_cond_wait( &p.changed, &p.lock );
+    }
+    failed = p.failed;
+    pthread_mutex_unlock( &p.lock );
+    if( failed || ended == filecount )
+      break;
+    /* Every share must have the block, and all of the same length */
+    length = p.lengths[0][slot];
+    for( i = 0; i < filecount && ready == filecount; ++i ) {
+      if( p.lengths[i][slot] != length )
+        break;
+      blocks[i] = p.rings[i][slot];
+    }
+    if( i < filecount ) {
+      fprintf( stderr, "Mismatch during file read.\n");
+      failed = 1;
+      break;
+    }
+
+    gfshare_ctx_dec_extract_shares( G, blocks, buffer, length );
+    bytes_written = fwrite( buffer, 1, length, outfile );
+    if( bytes_written != length ||
+        note_output( shares, buffer, length ) ) {
+      fprintf( stderr, "Mismatch during file write.\n");
+      failed = 1;
+      break;
+    }
+
+    pthread_mutex_lock( &p.lock );
+    p.nconsumed = block + 1;
+    pthread_cond_broadcast( &p.changed );
+    pthread_mutex_unlock( &p.lock );
+  }
+
+  /* Stop any reader still waiting for room */
+  pthread_mutex_lock( &p.lock );
+  p.failed |= failed;
+  pthread_cond_broadcast( &p.changed );
+  pthread_mutex_unlock( &p.lock );
+  for( i = 0; i < started; ++i )
+    pthread_join( threads[i], NULL );
+  pthread_cond_destroy( &p.changed );
+  pthread_mutex_destroy( &p.lock );
+  /* Don't leave the recombined secret lying around in the heap */
+  memset( buffer, 0, p.blocksize );
+  free( buffer );
+  return p.failed;
+}
+#endif
+
+static int
+do_gfcombine( char *outputfilename, char **inputfilenames, int filecount,
+              unsigned int readahead, unsigned char target )
 {
   FILE *outfile;
   FILE **inputfiles = malloc( sizeof(FILE*) * filecount );
-  unsigned char* sharenrs = malloc( filecount );
+  int *inputfds = malloc( sizeof(int) * filecount );
   int i;
   unsigned char *buffer = malloc( BUFFER_SIZE );
+  unsigned char **sharebuffers = malloc( sizeof(unsigned char*) * filecount );
+  gfcombine_shares shares;
+  uint64_t offset = 0;
   gfshare_ctx *G;
-  unsigned int len1 = 0;
   
-  if( inputfiles == NULL || sharenrs == NULL || buffer == NULL ) {
+  if( inputfiles == NULL || inputfds == NULL || buffer == NULL || sharebuffers == NULL ) {
     perror( "malloc" );
     return 1;
   }
-  
+  for( i = 0; i < filecount; ++i ) {
+    sharebuffers[i] = malloc( BUFFER_SIZE );
+    if( sharebuffers[i] == NULL ) {
+      perror( "malloc" );
+      return 1;
+    }
+  }
+  for( i = 0; i < filecount; ++i ) {
+    inputfiles[i] = fopen( inputfilenames[i], "rb" );
+    if( inputfiles[i] == NULL ) {
+      perror(inputfilenames[i]);
+      return 1;
+    }
+    inputfds[i] = fileno(inputfiles[i]);
+  }
+  if( describe_shares( &shares, inputfilenames, inputfds, filecount ) )
+    return 1;
+  for( i = 0; i < filecount && shares.base != 0; ++i ) {
+    if( fseek( inputfiles[i], shares.base, SEEK_SET ) != 0 ) {
+      perror(inputfilenames[i]);
+      return 1;
+    }
+  }
+  if( check_target( &shares, inputfilenames, filecount, target ) )
+    return 1;
+
   if (strcmp(outputfilename, "-") == 0)
     outfile = fdopen(STDOUT_FILENO, "w");
   else 
@@ -114,62 +639,894 @@ do_gfcombine( char *outputfilename, char **inputfilenames, int filecount )
     perror((strcmp(outputfilename, "-") == 0) ? "standard out" : outputfilename);
     return 1;
   }
-  for( i = 0; i < filecount; ++i ) {
-    inputfiles[i] = fopen( inputfilenames[i], "rb" );
-    if( inputfiles[i] == NULL ) {
-      perror(inputfilenames[i]);
+  
+  /* The shares are read into our own buffers and interpolated in place,
+   * so the context itself needs no share storage to speak of.
+   */
+  G = start_decoder( &shares, filecount, target, outputfilename,
+                     fileno(outfile) );
+  if( !G )
+    return 1;
+
+#ifdef HAVE_PTHREAD_H
+  /* A single block has nothing to overlap with */
+  if( shares.length > BUFFER_SIZE ) {
+    int failed = combine_pipelined( G, inputfiles, inputfilenames, &shares,
+                                    filecount, outfile, readahead );
+    gfshare_ctx_free( G );
+    if( failed || finish_shares( &shares, inputfilenames, filecount ) ||
+        fflush(outfile) != 0 ||
+        finish_output( &shares, outputfilename, fileno(outfile) ) )
+      return 1;
+    if( fclose(outfile) != 0 ) {
+      perror(outputfilename);
       return 1;
     }
-    sharenrs[i] = strtoul( inputfilenames[i] + strlen(inputfilenames[i]) - 3, 
-                           NULL, 10 );
-    if( i == 0 ) len1 = getlen(inputfiles[0]);
-    else {
-      if( len1 != getlen(inputfiles[1]) ) {
-        fprintf( stderr, "%s: File length mismatch between input files.\n", progname );
-        return 1;
-      }
-    }
+    for( i = 0; i < filecount; ++i ) fclose(inputfiles[i]);
+    return 0;
   }
-  
-  G = gfshare_ctx_init_dec( sharenrs, filecount, filecount, BUFFER_SIZE );
-  
-  while( !feof(inputfiles[0]) ) {
-    unsigned int bytes_read = fread( buffer, 1, BUFFER_SIZE, inputfiles[0] );
+#else
+  (void)readahead;
+#endif
+  while( !feof(inputfiles[0]) && offset < shares.length ) {
+    unsigned int want = MIN(BUFFER_SIZE, shares.length - offset);
+    unsigned int bytes_read = fread( sharebuffers[0], 1, want, inputfiles[0] );
     unsigned int bytes_written;
-    gfshare_ctx_dec_giveshare( G, 0, buffer );
     for( i = 1; i < filecount; ++i ) {
-      unsigned int bytes_read_2 = fread( buffer, 1, BUFFER_SIZE, 
+      unsigned int bytes_read_2 = fread( sharebuffers[i], 1, want,
                                          inputfiles[i] );
       if( bytes_read != bytes_read_2 ) {
         fprintf( stderr, "Mismatch during file read.\n");
         gfshare_ctx_free( G );
         return 1;
       }
-      gfshare_ctx_dec_giveshare( G, i, buffer );
     }
-    gfshare_ctx_dec_extract( G, buffer );
+    for( i = 0; i < filecount; ++i ) {
+      if( check_share( &shares, i, inputfilenames[i], sharebuffers[i],
+                       bytes_read ) ) {
+        gfshare_ctx_free( G );
+        return 1;
+      }
+    }
+    gfshare_ctx_dec_extract_shares( G, (const unsigned char* const*)sharebuffers,
+                                    buffer, bytes_read );
     bytes_written = fwrite( buffer, 1, bytes_read, outfile );
-    if( bytes_written != bytes_read ) {
+    if( bytes_written != bytes_read ||
+        note_output( &shares, buffer, bytes_read ) ) {
       fprintf( stderr, "Mismatch during file write.\n");
       gfshare_ctx_free( G );
       return 1;
     }
+    offset += bytes_read;
   }
+  gfshare_ctx_free( G );
+  if( finish_shares( &shares, inputfilenames, filecount ) ||
+      fflush(outfile) != 0 ||
+      finish_output( &shares, outputfilename, fileno(outfile) ) )
+    return 1;
   fclose(outfile);
   for( i = 0; i < filecount; ++i ) fclose(inputfiles[i]);
   return 0;
 }
 
-#define OPTSTRING "o:hv"
+/* write() all of 'len' bytes */
+static int
+write_all( int fd, const unsigned char* buffer, unsigned int len )
+{
+  unsigned int done = 0;
+  while( done < len ) {
+    ssize_t n = write( fd, buffer + done, len - done );
+    if( n < 0 && errno == EINTR )
+      continue;
+    if( n <= 0 )
+      return 1;
+    done += n;
+  }
+  return 0;
+}
+
+#ifdef GFCOMBINE_MMAP
+/* Combine a window at a time straight out of mappings of the shares,
+ * writing each window of the result with a single write().
+ */
+static int
+do_gfcombine_mmap( char *outputfilename, char **inputfilenames, int filecount,
+                   unsigned char target )
+{
+  int outfd;
+  int *inputfds = malloc( sizeof(int) * filecount );
+  int i;
+  unsigned char *buffer = malloc( MMAP_WINDOW );
+  unsigned char **sharebuffers = malloc( sizeof(unsigned char*) * filecount );
+  struct stat st;
+  gfcombine_shares shares;
+  off_t offset;
+  gfshare_ctx *G;
+
+  if( inputfds == NULL || buffer == NULL || sharebuffers == NULL ) {
+    perror( "malloc" );
+    return 1;
+  }
+
+  for( i = 0; i < filecount; ++i ) {
+    inputfds[i] = open( inputfilenames[i], O_RDONLY );
+    if( inputfds[i] < 0 || fstat( inputfds[i], &st ) != 0 ) {
+      perror(inputfilenames[i]);
+      return 1;
+    }
+    if( !S_ISREG(st.st_mode) ) {
+      fprintf( stderr, "%s: %s: -M needs regular files\n", progname, inputfilenames[i] );
+      return 1;
+    }
+  }
+  if( describe_shares( &shares, inputfilenames, inputfds, filecount ) ||
+      check_target( &shares, inputfilenames, filecount, target ) )
+    return 1;
+
+  if (strcmp(outputfilename, "-") == 0)
+    outfd = STDOUT_FILENO;
+  else
+    outfd = open( outputfilename, O_WRONLY | O_CREAT | O_TRUNC, 0666 );
+
+  if( outfd < 0 ) {
+    perror(outputfilename);
+    return 1;
+  }
+
+  G = start_decoder( &shares, filecount, target, outputfilename, outfd );
+  if( !G )
+    return 1;
+  /* Windows are big enough to be worth sharing between the CPUs */
+  gfshare_ctx_set_threads( G, 0 );
+  for( offset = 0; (uint64_t)offset < shares.length; offset += MMAP_WINDOW ) {
+    unsigned int len = MMAP_WINDOW;
+    if( shares.length - offset < MMAP_WINDOW )
+      len = shares.length - offset;
+    /* Windows start on a page, so a container's header is mapped too */
+    for( i = 0; i < filecount; ++i ) {
+      sharebuffers[i] = mmap( NULL, shares.base + len, PROT_READ, MAP_SHARED,
+                              inputfds[i], offset );
+      if( sharebuffers[i] == MAP_FAILED ) {
+        perror(inputfilenames[i]);
+        gfshare_ctx_free( G );
+        return 1;
+      }
+#ifdef HAVE_MADVISE
+      madvise( sharebuffers[i], shares.base + len, MADV_SEQUENTIAL );
+#endif
+      sharebuffers[i] += shares.base;
+      if( check_share( &shares, i, inputfilenames[i], sharebuffers[i], len ) ) {
+        gfshare_ctx_free( G );
+        return 1;
+      }
+    }
+    gfshare_ctx_dec_extract_shares( G, (const unsigned char* const*)sharebuffers,
+                                    buffer, len );
+    for( i = 0; i < filecount; ++i )
+      munmap( sharebuffers[i] - shares.base, shares.base + len );
+    if( write_all( outfd, buffer, len ) ||
+        note_output( &shares, buffer, len ) ) {
+      fprintf( stderr, "Mismatch during file write.\n");
+      gfshare_ctx_free( G );
+      return 1;
+    }
+  }
+  gfshare_ctx_free( G );
+  if( finish_shares( &shares, inputfilenames, filecount ) ||
+      finish_output( &shares, outputfilename, outfd ) )
+    return 1;
+  /* Don't leave the recombined secret lying around in the heap */
+  memset( buffer, 0, MMAP_WINDOW );
+  free( buffer );
+  for( i = 0; i < filecount; ++i ) close(inputfds[i]);
+  if( close(outfd) != 0 ) {
+    perror(outputfilename);
+    return 1;
+  }
+  return 0;
+}
+#endif
+
+/* Recombine only [offset, offset+length) of the secret, reading just that
+ * range of each share with pread(). Containers are read from the start
+ * of the first index block the range touches to the end of the last, so
+ * that every block used can still be checked.
+ */
+#define RANGE_CHUNK (1024 * 1024)
+
+static int
+do_gfcombine_range( char *outputfilename, char **inputfilenames,
+                    int filecount, uint64_t offset, uint64_t length )
+{
+  int outfd;
+  int *inputfds = malloc( sizeof(int) * filecount );
+  unsigned char *buffer = malloc( RANGE_CHUNK );
+  unsigned char **sharebuffers = malloc( sizeof(unsigned char*) * filecount );
+  gfcombine_shares shares;
+  uint64_t start, end, pos;
+  uint32_t align = 1;
+  gfshare_ctx *G;
+  int i;
+
+  if( inputfds == NULL || buffer == NULL || sharebuffers == NULL ) {
+    perror( "malloc" );
+    return 1;
+  }
+  for( i = 0; i < filecount; ++i ) {
+    sharebuffers[i] = malloc( RANGE_CHUNK );
+    if( sharebuffers[i] == NULL ) {
+      perror( "malloc" );
+      return 1;
+    }
+    inputfds[i] = open( inputfilenames[i], O_RDONLY );
+    if( inputfds[i] < 0 ) {
+      perror(inputfilenames[i]);
+      return 1;
+    }
+  }
+  if( describe_shares( &shares, inputfilenames, inputfds, filecount ) )
+    return 1;
+  if( shares.length == UINT64_MAX ) {
+    fprintf( stderr, "%s: --offset and --length need regular files\n", progname );
+    return 1;
+  }
+  if( offset > shares.length ) {
+    fprintf( stderr, "%s: Offset %llu is beyond the end of the shares\n",
+             progname, (unsigned long long)offset );
+    return 1;
+  }
+  if( length > shares.length - offset )
+    length = shares.length - offset;
+
+  start = offset;
+  end = offset + length;
+  if( shares.checks != NULL ) {
+    align = shares.checks[0].blocksize;
+    start -= start % align;
+    end += (align - (end % align)) % align;
+    if( end > shares.length )
+      end = shares.length;
+    /* Check the blocks from 'start' on, and only those */
+    for( i = 0; i < filecount; ++i ) {
+      gfshare_index *check = &shares.checks[i];
+      uint64_t first = start / align, blocks = (end - start + align - 1) / align;
+      gfshare_index_init( check, align, check->expect + first, blocks );
+    }
+  }
+
+  if (strcmp(outputfilename, "-") == 0)
+    outfd = STDOUT_FILENO;
+  else
+    outfd = open( outputfilename, O_WRONLY | O_CREAT | O_TRUNC, 0666 );
+  if( outfd < 0 ) {
+    perror(outputfilename);
+    return 1;
+  }
+
+  G = gfshare_ctx_init_dec( shares.sharenrs, filecount, filecount, 1 );
+  if( !G ) {
+    perror("gfshare_ctx_init_dec");
+    return 1;
+  }
+  for( pos = start; pos < end; pos += RANGE_CHUNK ) {
+    unsigned int len = MIN(RANGE_CHUNK, end - pos), skip, keep;
+    uint64_t lo, hi;
+    for( i = 0; i < filecount; ++i ) {
+      unsigned int done = 0;
+      while( done < len ) {
+        ssize_t n = pread( inputfds[i], sharebuffers[i] + done, len - done,
+                           shares.base + pos + done );
+        if( n < 0 && errno == EINTR )
+          continue;
+        if( n <= 0 ) {
+          if( n < 0 )
+            perror(inputfilenames[i]);
+          else
+            fprintf( stderr, "Mismatch during file read.\n");
+          gfshare_ctx_free( G );
+          return 1;
+        }
+        done += n;
+      }
+      if( check_share( &shares, i, inputfilenames[i], sharebuffers[i], len ) ) {
+        gfshare_ctx_free( G );
+        return 1;
+      }
+    }
+    /* Only the part of the chunk inside the range is recombined */
+    lo = (pos > offset) ? pos : offset;
+    hi = pos + len;
+    if( hi > offset + length )
+      hi = offset + length;
+    if( lo >= hi )
+      continue;
+    skip = lo - pos;
+    keep = hi - lo;
+    for( i = 0; i < filecount; ++i )
+      sharebuffers[i] += skip;
+    gfshare_ctx_dec_extract_shares( G, (const unsigned char* const*)sharebuffers,
+                                    buffer, keep );
+    for( i = 0; i < filecount; ++i )
+      sharebuffers[i] -= skip;
+    if( write_all( outfd, buffer, keep ) ) {
+      fprintf( stderr, "Mismatch during file write.\n");
+      gfshare_ctx_free( G );
+      return 1;
+    }
+  }
+  gfshare_ctx_free( G );
+  if( finish_shares( &shares, inputfilenames, filecount ) )
+    return 1;
+  /* Don't leave the recombined secret lying around in the heap */
+  memset( buffer, 0, RANGE_CHUNK );
+  free( buffer );
+  for( i = 0; i < filecount; ++i ) close(inputfds[i]);
+  if( close(outfd) != 0 ) {
+    perror(outputfilename);
+    return 1;
+  }
+  return 0;
+}
+
+/* Resharing: each tile of the shares is interpolated and split again,
+ * under fresh coefficients and to a new threshold and share set, in
+ * memory from the secure pool, and the tile of every new share written
+ * out. Tiles are independent of each other, so a worker per CPU takes
+ * them in turn, each with its own encoder and buffers; they share the
+ * decoder, which only holds the interpolation weights.
+ */
+#define RESHARE_TILE GFSHARE_FILE_BLOCK
+
+typedef struct {
+  gfcombine_shares *shares;
+  char **inputfilenames;
+  int *inputfds;
+  unsigned int filecount;
+  char **outputfilenames;
+  char **tempfilenames;    /* where each new share is written until done */
+  int *outputfds;
+  unsigned int sharecount;
+  off_t outbase;           /* where each new share starts in its file */
+  gfshare_index *indexes;  /* per new share, for containers */
+  const gfshare_ctx *dec;
+  unsigned int tile;
+  uint64_t tiles;
+  uint64_t next;           /* the next tile to be taken */
+  int failed;
+#ifdef HAVE_PTHREAD_H
+  pthread_mutex_t lock;
+#endif
+} gfreshare_job;
+
+typedef struct {
+  gfreshare_job *job;
+  gfshare_ctx *enc;
+  unsigned char *block;    /* the worker's old and new share tiles */
+  size_t blocksize;
+  unsigned char **oldshares;
+  unsigned char **newshares;
+} gfreshare_worker;
+
+/* Take the next tile, or return 0 once there are none or one failed */
+static int
+reshare_next( gfreshare_job* job, uint64_t* tile, int failed )
+{
+  int more;
+#ifdef HAVE_PTHREAD_H
+  pthread_mutex_lock( &job->lock );
+#endif
+  job->failed |= failed;
+  *tile = job->next++;
+  more = !job->failed && *tile < job->tiles;
+#ifdef HAVE_PTHREAD_H
+  pthread_mutex_unlock( &job->lock );
+#endif
+  return more;
+}
+
+static void*
+reshare_worker( void* arg )
+{
+  gfreshare_worker *w = arg;
+  gfreshare_job *job = w->job;
+  uint64_t tile, offset;
+  unsigned int i, len;
+  int failed = 0;
+
+  while( reshare_next( job, &tile, failed ) ) {
+    offset = tile * job->tile;
+    len = MIN(job->tile, job->shares->length - offset);
+    for( i = 0; i < job->filecount && !failed; ++i ) {
+      if( gfshare_file_pread( job->inputfds[i], w->oldshares[i], len,
+                              job->shares->base + offset ) ) {
+        perror(job->inputfilenames[i]);
+        failed = 1;
+      } else if( job->shares->checks != NULL &&
+                 gfshare_index_check( &job->shares->checks[i], tile,
+                                      w->oldshares[i], len ) ) {
+        fprintf( stderr, "%s: %s: block %lu is damaged\n", progname,
+                 job->inputfilenames[i], (unsigned long)tile );
+        failed = 1;
+      }
+    }
+    if( !failed &&
+        gfshare_ctx_reshare( w->enc, job->dec,
+                             (const unsigned char* const*)w->oldshares,
+                             w->newshares, len ) ) {
+      perror("gfshare_ctx_reshare");
+      failed = 1;
+    }
+    for( i = 0; i < job->sharecount && !failed; ++i ) {
+      if( job->indexes != NULL )
+        gfshare_index_put( &job->indexes[i], tile, w->newshares[i], len );
+      if( gfshare_file_pwrite( job->outputfds[i], w->newshares[i], len,
+                               job->outbase + offset ) ) {
+        perror(job->tempfilenames[i]);
+        failed = 1;
+      }
+    }
+  }
+  return NULL;
+}
+
+/* Give a worker an encoder and its buffers, all from the secure pool */
+static int
+start_worker( gfreshare_worker* w, gfreshare_job* job,
+              const gfshare_allocator* secure, const unsigned char* sharenrs,
+              unsigned int threshold )
+{
+  unsigned int i, rows = job->filecount + job->sharecount;
+  gfshare_allocator previous;
+
+  memset( w, 0, sizeof(*w) );
+  w->job = job;
+  w->oldshares = malloc( sizeof(unsigned char*) * rows );
+  if( w->oldshares == NULL )
+    return 1;
+  w->newshares = w->oldshares + job->filecount;
+  w->blocksize = (size_t)rows * job->tile;
+  w->block = secure->alloc( w->blocksize, 64, secure->data );
+  if( w->block == NULL )
+    return 1;
+  for( i = 0; i < rows; ++i )
+    w->oldshares[i] = w->block + ((size_t)i * job->tile);
+  /* Only the encoder is wanted from the secure pool; this runs before
+   * any worker thread starts, and whatever allocator was in use is put
+   * back afterwards.
+   */
+  gfshare_get_allocator( &previous );
+  gfshare_set_allocator( secure );
+  w->enc = gfshare_ctx_init_enc( sharenrs, job->sharecount, threshold,
+                                 job->tile );
+  gfshare_set_allocator( &previous );
+  return w->enc == NULL;
+}
+
+static void
+stop_worker( gfreshare_worker* w, const gfshare_allocator* secure )
+{
+  if( w->enc != NULL )
+    gfshare_ctx_free( w->enc );
+  /* Enough of the old shares are here to give the secret away */
+  if( w->block != NULL ) {
+    memset( w->block, 0, w->blocksize );
+    secure->free( w->block, w->blocksize, secure->data );
+  }
+  free( w->oldshares );
+}
+
+/* Pick 'sharecount' new share numbers, none of them in use by the inputs
+ * and none whose file (<outputstem>.NNN) already exists, such as another
+ * share of the old set which wasn't given
+ */
+static int
+pick_sharenrs( unsigned char* sharenrs, unsigned int sharecount,
+               const unsigned char* used, unsigned int usedcount,
+               const char* outputstem )
+{
+  unsigned char taken[256];
+  char *name = malloc( strlen(outputstem) + 5 );
+  unsigned int i, left = 0;
+  struct stat st;
+
+  if( name == NULL ) {
+    perror( "malloc" );
+    return 1;
+  }
+  memset( taken, 0, sizeof(taken) );
+  taken[0] = 1;
+  for( i = 0; i < usedcount; ++i )
+    taken[used[i]] = 1;
+  for( i = 1; i < 256; ++i ) {
+    sprintf( name, "%s.%03u", outputstem, i );
+    if( lstat( name, &st ) == 0 )
+      taken[i] = 1;
+    if( !taken[i] )
+      left++;
+  }
+  free( name );
+  if( sharecount > left ) {
+    fprintf( stderr, "%s: Only %u share numbers are left to pick from\n",
+             progname, left );
+    return 1;
+  }
+  for( i = 0; i < sharecount; ++i ) {
+    unsigned char proposed = (random() & 0xff00) >> 8;
+    while( taken[proposed] )
+      proposed++;
+    taken[proposed] = 1;
+    sharenrs[i] = proposed;
+  }
+  return 0;
+}
+
+/* Remove the new shares written so far, after a failure */
+static int
+abandon_outputs( gfreshare_job* job, unsigned int count )
+{
+  unsigned int i;
+  for( i = 0; i < count; ++i )
+    unlink( job->tempfilenames[i] );
+  return 1;
+}
+
+/* Give every finished new share its real name. link() never replaces a
+ * file which is already there, so no input (whatever it is called) and
+ * no share of the old set can be overwritten; if any name turns out to
+ * be taken, none of the new set is kept.
+ */
+static int
+publish_outputs( gfreshare_job* job )
+{
+  struct stat st, input;
+  unsigned int i, j;
+  int linked;
+
+  for( i = 0; i < job->sharecount; ++i ) {
+    linked = 0;
+    for( j = 0; j < job->filecount; ++j ) {
+      if( stat( job->outputfilenames[i], &st ) == 0 &&
+          fstat( job->inputfds[j], &input ) == 0 &&
+          st.st_dev == input.st_dev && st.st_ino == input.st_ino ) {
+        fprintf( stderr, "%s: %s: is the input %s\n", progname,
+                 job->outputfilenames[i], job->inputfilenames[j] );
+        break;
+      }
+    }
+    if( j == job->filecount ) {
+      linked = link( job->tempfilenames[i], job->outputfilenames[i] ) == 0;
+      if( !linked )
+        perror(job->outputfilenames[i]);
+    }
+    if( !linked ) {
+      for( j = 0; j < i; ++j )
+        unlink( job->outputfilenames[j] );
+      return abandon_outputs( job, job->sharecount );
+    }
+  }
+  abandon_outputs( job, job->sharecount );
+  return 0;
+}
+
+static int
+do_gfreshare( char *outputstem, char **inputfilenames, int filecount,
+              unsigned int threshold, unsigned int sharecount )
+{
+  gfreshare_job job;
+  gfreshare_worker *workers;
+  gfshare_allocator secure;
+  gfcombine_shares shares;
+  unsigned char *sharenrs = malloc( sharecount );
+  char *outputfilebuffer = malloc( strlen(outputstem) + 12 );
+  gfshare_ctx *dec;
+  mode_t mask;
+  unsigned int i, nworkers = 1, started;
+#ifdef HAVE_PTHREAD_H
+  pthread_t *threads;
+  long online = sysconf( _SC_NPROCESSORS_ONLN );
+  if( online > 1 )
+    nworkers = online;
+#endif
+
+  memset( &job, 0, sizeof(job) );
+  job.inputfds = malloc( sizeof(int) * filecount );
+  job.outputfds = malloc( sizeof(int) * sharecount );
+  job.outputfilenames = malloc( sizeof(char*) * sharecount );
+  job.tempfilenames = malloc( sizeof(char*) * sharecount );
+  workers = calloc( nworkers, sizeof(gfreshare_worker) );
+#ifdef HAVE_PTHREAD_H
+  threads = malloc( sizeof(pthread_t) * nworkers );
+  if( threads == NULL ) {
+    perror( "malloc" );
+    return 1;
+  }
+#endif
+  if( sharenrs == NULL || outputfilebuffer == NULL || job.inputfds == NULL ||
+      job.outputfds == NULL || job.outputfilenames == NULL ||
+      job.tempfilenames == NULL || workers == NULL ) {
+    perror( "malloc" );
+    return 1;
+  }
+  if( gfshare_secure_allocator( &secure ) ) {
+    fprintf( stderr, "%s: Resharing needs memory which can be locked\n",
+             progname );
+    return 1;
+  }
+  for( i = 0; i < (unsigned int)filecount; ++i ) {
+    job.inputfds[i] = open( inputfilenames[i], O_RDONLY );
+    if( job.inputfds[i] < 0 ) {
+      perror(inputfilenames[i]);
+      return 1;
+    }
+  }
+  if( describe_shares( &shares, inputfilenames, job.inputfds, filecount ) )
+    return 1;
+  if( shares.length == UINT64_MAX ) {
+    fprintf( stderr, "%s: Resharing needs regular files\n", progname );
+    return 1;
+  }
+  if( pick_sharenrs( sharenrs, sharecount, shares.sharenrs, filecount,
+                     outputstem ) )
+    return 1;
+
+  job.shares = &shares;
+  job.inputfilenames = inputfilenames;
+  job.filecount = filecount;
+  job.sharecount = sharecount;
+  job.tile = shares.container ? shares.checks[0].blocksize : RESHARE_TILE;
+  job.tiles = (shares.length + job.tile - 1) / job.tile;
+  if( shares.container ) {
+    job.outbase = GFSHARE_FILE_HEADER;
+    job.indexes = malloc( sizeof(gfshare_index) * sharecount );
+    if( job.indexes == NULL ) {
+      perror( "malloc" );
+      return 1;
+    }
+  }
+  /* The new shares are written to temporary files beside where they will
+   * end up, and only named once they are all complete
+   */
+  mask = umask( 0 );
+  umask( mask );
+  for( i = 0; i < sharecount; ++i ) {
+    sprintf( outputfilebuffer, "%s.%03d", outputstem, sharenrs[i] );
+    job.outputfilenames[i] = strdup(outputfilebuffer);
+    strcat( outputfilebuffer, ".XXXXXX" );
+    job.outputfds[i] = mkstemp( outputfilebuffer );
+    if( job.outputfds[i] < 0 ) {
+      perror(outputfilebuffer);
+      return abandon_outputs( &job, i );
+    }
+    job.tempfilenames[i] = strdup(outputfilebuffer);
+    if( job.outputfilenames[i] == NULL || job.tempfilenames[i] == NULL ) {
+      perror( "malloc" );
+      unlink( outputfilebuffer );
+      return abandon_outputs( &job, i );
+    }
+    (void)fchmod( job.outputfds[i], 0666 & ~mask );
+    if( job.indexes != NULL ) {
+      gfshare_index_init( &job.indexes[i], job.tile, NULL, 0 );
+      if( gfshare_index_reserve( &job.indexes[i], job.tiles ) ) {
+        perror( "malloc" );
+        return abandon_outputs( &job, i + 1 );
+      }
+    }
+  }
+
+  dec = gfshare_ctx_init_dec( shares.sharenrs, filecount, filecount, 1 );
+  if( !dec ) {
+    perror("gfshare_ctx_init_dec");
+    return abandon_outputs( &job, sharecount );
+  }
+  job.dec = dec;
+  /* No more workers than tiles, or than there is locked memory for */
+  if( nworkers > job.tiles )
+    nworkers = job.tiles ? job.tiles : 1;
+  for( started = 0; started < nworkers; ++started ) {
+    if( start_worker( &workers[started], &job, &secure, sharenrs,
+                      threshold ) ) {
+      stop_worker( &workers[started], &secure );
+      break;
+    }
+  }
+  if( started == 0 ) {
+    perror( "Unable to lock memory for resharing" );
+    gfshare_ctx_free( dec );
+    return abandon_outputs( &job, sharecount );
+  }
+  nworkers = started;
+
+#ifdef HAVE_PTHREAD_H
+  pthread_mutex_init( &job.lock, NULL );
+  for( started = 1; started < nworkers; ++started ) {
+    if( pthread_create( &threads[started], NULL, reshare_worker,
+                        &workers[started] ) != 0 )
+      break;
+  }
+#endif
+  reshare_worker( &workers[0] );
+#ifdef HAVE_PTHREAD_H
+  for( i = 1; i < started; ++i )
+    pthread_join( threads[i], NULL );
+  pthread_mutex_destroy( &job.lock );
+#endif
+  for( i = 0; i < nworkers; ++i )
+    stop_worker( &workers[i], &secure );
+  gfshare_ctx_free( dec );
+  if( job.failed )
+    return abandon_outputs( &job, sharecount );
+
+  for( i = 0; i < sharecount; ++i ) {
+    if( (job.indexes != NULL &&
+         finish_container( job.outputfds[i], sharenrs[i], threshold,
+                           shares.length, &job.indexes[i] )) ||
+        close( job.outputfds[i] ) != 0 ) {
+      perror(job.tempfilenames[i]);
+      return abandon_outputs( &job, sharecount );
+    }
+  }
+  if( publish_outputs( &job ) )
+    return 1;
+  for( i = 0; i < (unsigned int)filecount; ++i ) close(job.inputfds[i]);
+  return 0;
+}
+
+/* Check containers on their own, without needing the other shares: each
+ * is read (by a thread of its own, where possible) and every block is
+ * checked against its index.
+ */
+#define VERIFY_CHUNK (1024 * 1024)
+
+typedef struct {
+  const char *filename;
+  gfshare_file_header header;
+  const char *problem;    /* NULL if the share is intact */
+  int64_t bad;            /* the first damaged block, or -1 */
+} gfverify_job;
+
+static void*
+verify_share( void* arg )
+{
+  gfverify_job *job = arg;
+  gfshare_index check;
+  unsigned char *chunk = malloc( VERIFY_CHUNK );
+  uint32_t *crcs;
+  uint64_t ncrcs, offset = 0;
+  int fd = open( job->filename, O_RDONLY );
+
+  job->bad = -1;
+  if( chunk == NULL ) {
+    job->problem = strerror(ENOMEM);
+  } else if( fd < 0 ) {
+    job->problem = strerror(errno);
+  } else if( gfshare_file_read_header( fd, &job->header ) ) {
+    job->problem = (errno == ENOTSUP) ? "made by a newer gfsplit" :
+                   (errno == EFBIG) ? "share is truncated"
+                                    : "not a share container";
+  } else if( gfshare_file_read_index( fd, &job->header, &crcs, &ncrcs ) ) {
+    job->problem = "index is damaged";
+  } else {
+    gfshare_index_init( &check, job->header.blocksize, crcs, ncrcs );
+    while( offset < job->header.length ) {
+      size_t want = VERIFY_CHUNK;
+      ssize_t n;
+      if( job->header.length - offset < want )
+        want = job->header.length - offset;
+      n = pread( fd, chunk, want, GFSHARE_FILE_HEADER + offset );
+      if( n < 0 && errno == EINTR )
+        continue;
+      if( n <= 0 ) {
+        job->problem = (n < 0) ? strerror(errno) : "share is truncated";
+        break;
+      }
+      if( gfshare_index_update( &check, chunk, n ) ) {
+        job->problem = strerror(ENOMEM);
+        break;
+      }
+      offset += n;
+    }
+    if( job->problem == NULL && gfshare_index_finish( &check ) == 0 &&
+        check.bad >= 0 ) {
+      job->problem = "damaged";
+      job->bad = check.bad;
+    }
+    free( crcs );
+  }
+  if( fd >= 0 )
+    close( fd );
+  free( chunk );
+  return NULL;
+}
+
+static int
+do_gfverify( char **filenames, int count )
+{
+  gfverify_job *jobs = calloc( count, sizeof(gfverify_job) );
+#ifdef HAVE_PTHREAD_H
+  pthread_t *threads = malloc( sizeof(pthread_t) * count );
+  int *started = calloc( count, sizeof(int) );
+#endif
+  int i, failed = 0;
+
+  if( jobs == NULL
+#ifdef HAVE_PTHREAD_H
+      || threads == NULL || started == NULL
+#endif
+    ) {
+    perror( "malloc" );
+    return 1;
+  }
+  for( i = 0; i < count; ++i ) {
+    jobs[i].filename = filenames[i];
+#ifdef HAVE_PTHREAD_H
+    started[i] = pthread_create( &threads[i], NULL, verify_share,
+                                 &jobs[i] ) == 0;
+    if( !started[i] )
+#endif
+      verify_share( &jobs[i] );
+  }
+  for( i = 0; i < count; ++i ) {
+#ifdef HAVE_PTHREAD_H
+    if( started[i] )
+      pthread_join( threads[i], NULL );
+#endif
+    if( jobs[i].bad >= 0 ) {
+      fprintf( stdout, "%s: block %lu is damaged\n", jobs[i].filename,
+               (unsigned long)jobs[i].bad );
+      failed = 1;
+    } else if( jobs[i].problem != NULL ) {
+      fprintf( stdout, "%s: %s\n", jobs[i].filename, jobs[i].problem );
+      failed = 1;
+    } else {
+      fprintf( stdout, "%s: OK (share %d, threshold %d, %lu bytes)\n",
+               jobs[i].filename, jobs[i].header.sharenr,
+               jobs[i].header.threshold,
+               (unsigned long)jobs[i].header.length );
+    }
+  }
+  return failed;
+}
+
+/* Parse a byte count for --offset or --length */
+static int
+parse_bytes( const char* arg, uint64_t* value )
+{
+  char *endptr;
+  errno = 0;
+  *value = strtoull( arg, &endptr, 10 );
+  if( *arg == 0 || *endptr != 0 || errno != 0 || *arg == '-' ) {
+    fprintf( stderr, "%s: Invalid byte count %s\n", progname, arg );
+    return 1;
+  }
+  return 0;
+}
+
+#define OPTSTRING "o:Mr:x:n:m:Vhv"
+enum { OPT_OFFSET = 256, OPT_LENGTH };
+static const struct option longopts[] = {
+  { "offset", required_argument, NULL, OPT_OFFSET },
+  { "length", required_argument, NULL, OPT_LENGTH },
+  { NULL, 0, NULL, 0 }
+};
+
 int
 main( int argc, char **argv )
 {
   int optnr;
   char *outputfile = NULL;
+  unsigned int readahead = 0;
+  int verify = 0, ranged = 0;
+  unsigned long target = 0, threshold = 0, sharecount = 0;
+  char *endptr;
+  uint64_t offset = 0, length = UINT64_MAX;
+#ifdef GFCOMBINE_MMAP
+  int use_mmap = 0;
+#endif
   
   progname = argv[0];
+  srandom( time(NULL) );
   
-  while( (optnr = getopt(argc, argv, OPTSTRING)) != -1 ) {
+  while( (optnr = getopt_long(argc, argv, OPTSTRING, longopts, NULL)) != -1 ) {
     switch( optnr ) {
     case 'v':
       fprintf( stdout, "%s", "\
@@ -190,15 +1547,113 @@ warranty; not even for MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.\n\
     case 'o':
       outputfile = optarg;
       break;
+    case 'M':
+#ifdef GFCOMBINE_MMAP
+      use_mmap = 1;
+#else
+      fprintf( stderr, "%s: -M is not supported on this system\n", progname );
+      return 1;
+#endif
+      break;
+    case 'V':
+      verify = 1;
+      break;
+    case 'x':
+      target = strtoul( optarg, &endptr, 10 );
+      if( *optarg == 0 || *endptr != 0 || target < 1 || target > 255 ) {
+        fprintf( stderr, "%s: Share number must be between 1 and 255\n",
+                 progname );
+        return 1;
+      }
+      break;
+    case 'n':
+      threshold = strtoul( optarg, &endptr, 10 );
+      if( *optarg == 0 || *endptr != 0 || threshold < 2 || threshold > 255 ) {
+        fprintf( stderr, "%s: Invalid argument to option -n\n", progname );
+        return 1;
+      }
+      break;
+    case 'm':
+      sharecount = strtoul( optarg, &endptr, 10 );
+      if( *optarg == 0 || *endptr != 0 || sharecount < 2 || sharecount > 255 ) {
+        fprintf( stderr, "%s: Invalid argument to option -m\n", progname );
+        return 1;
+      }
+      break;
+    case OPT_OFFSET:
+      if( parse_bytes( optarg, &offset ) ) return 1;
+      ranged = 1;
+      break;
+    case OPT_LENGTH:
+      if( parse_bytes( optarg, &length ) ) return 1;
+      ranged = 1;
+      break;
+    case 'r':
+#ifdef HAVE_PTHREAD_H
+      readahead = strtoul( optarg, &endptr, 10 );
+      if( *optarg == 0 || *endptr != 0 ||
+          readahead < 1 || readahead > MAX_READAHEAD ) {
+        fprintf( stderr, "%s: Read-ahead must be between 1 and %d blocks\n",
+                 progname, MAX_READAHEAD );
+        return 1;
+      }
+#else
+      fprintf( stderr, "%s: -r is not supported on this system\n", progname );
+      return 1;
+#endif
+      break;
     }
   }
+#ifdef HAVE_PTHREAD_H
+  if( readahead == 0 )
+    readahead = DEFAULT_READAHEAD;
+#endif
   
+  if( verify ) {
+    if( optind == argc ) {
+      fprintf( stderr, "%s: No shares to verify\n", progname );
+      return 1;
+    }
+    return do_gfverify(argv+optind, argc-optind);
+  }
   if( check_filenames(argv+optind, argc-optind) ) return 1;
   
   if( outputfile == NULL ) {
+    /* A container may be called anything, so there may be nothing to strip */
+    if( !has_share_suffix(argv[optind]) ) {
+      fprintf( stderr, "%s: %s: no .NNN to strip for the output name, use -o\n",
+               progname, argv[optind] );
+      return 1;
+    }
     outputfile = strdup(argv[optind]);
     outputfile[strlen(outputfile)-4] = 0;
+    if( target != 0 )
+      sprintf( outputfile + strlen(outputfile), ".%03lu", target );
   }
   
-  return do_gfcombine(outputfile, argv+optind, argc-optind);
+  if( threshold != 0 || sharecount != 0 ) {
+    if( threshold == 0 || sharecount == 0 || threshold > sharecount ) {
+      fprintf( stderr, "%s: Resharing needs -n threshold and -m sharecount, with threshold <= sharecount\n", progname );
+      return 1;
+    }
+    if( ranged || target != 0 ) {
+      fprintf( stderr, "%s: -n and -m reshare whole shares only\n", progname );
+      return 1;
+    }
+    return do_gfreshare(outputfile, argv+optind, argc-optind, threshold,
+                        sharecount);
+  }
+  if( ranged && target != 0 ) {
+    fprintf( stderr, "%s: -x rebuilds whole shares only\n", progname );
+    return 1;
+  }
+  if( ranged )
+    return do_gfcombine_range(outputfile, argv+optind, argc-optind,
+                              offset, length);
+#ifdef GFCOMBINE_MMAP
+  if( use_mmap )
+    return do_gfcombine_mmap(outputfile, argv+optind, argc-optind, target);
+#endif
+  return do_gfcombine(outputfile, argv+optind, argc-optind, readahead,
+                      target);
 }
@@ -0,0 +1,438 @@
+/*
+ * This file is Copyright the libgfshare contributors 2026
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "config.h"
+#include "gfshare_file.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
+#ifdef HAVE_SSE42_TARGET
+#include <immintrin.h>
+#endif
+
+#define GFSHARE_FILE_MAGIC "gfshare"
+
+/* ----------------------------------------------------------[ CRC32C ]---- */
+
+/* Slicing-by-8 over the reflected Castagnoli polynomial */
+static uint32_t gfshare_crc32c_table[8][256];
+
+static void
+gfshare_crc32c_build( void )
+{
+  uint32_t crc;
+  unsigned int i, j;
+  for( i = 0; i < 256; ++i ) {
+    crc = i;
+    for( j = 0; j < 8; ++j )
+      crc = (crc >> 1) ^ ((crc & 1) ? 0x82f63b78 : 0);
+    gfshare_crc32c_table[0][i] = crc;
+  }
+  for( i = 0; i < 256; ++i )
+    for( j = 1; j < 8; ++j )
+      gfshare_crc32c_table[j][i] =
+        (gfshare_crc32c_table[j-1][i] >> 8) ^
+        gfshare_crc32c_table[0][gfshare_crc32c_table[j-1][i] & 0xff];
+}
+
+static uint32_t
+gfshare_crc32c_sw( uint32_t crc, const unsigned char* p, size_t len )
+{
+  const uint32_t (*t)[256] = (const uint32_t (*)[256])gfshare_crc32c_table;
+  while( len >= 8 ) {
+    uint32_t lo = crc ^ (p[0] | (p[1] << 8) | (p[2] << 16) |
+                         ((uint32_t)p[3] << 24));
+    crc = t[7][lo & 0xff] ^ t[6][(lo >> 8) & 0xff] ^
+          t[5][(lo >> 16) & 0xff] ^ t[4][lo >> 24] ^
+          t[3][p[4]] ^ t[2][p[5]] ^ t[1][p[6]] ^ t[0][p[7]];
+    p += 8;
+    len -= 8;
+  }
+  while( len-- > 0 )
+    crc = (crc >> 8) ^ t[0][(crc ^ *p++) & 0xff];
+  return crc;
+}
+
+#ifdef HAVE_SSE42_TARGET
+__attribute__((target("sse4.2")))
+static uint32_t
+gfshare_crc32c_sse42( uint32_t crc, const unsigned char* p, size_t len )
+{
+  uint64_t c = crc;
+  while( len > 0 && ((size_t)p & 7) != 0 ) {
+    c = _mm_crc32_u8( (uint32_t)c, *p++ );
+    len--;
+  }
+  while( len >= 8 ) {
+    uint64_t v;
+    memcpy( &v, p, 8 );
+    c = _mm_crc32_u64( c, v );
+    p += 8;
+    len -= 8;
+  }
+  while( len-- > 0 )
+    c = _mm_crc32_u8( (uint32_t)c, *p++ );
+  return (uint32_t)c;
+}
+#endif
+
+static uint32_t (*gfshare_crc32c_func)( uint32_t, const unsigned char*,
+                                        size_t );
+
+static void
+gfshare_crc32c_select( void )
+{
+  gfshare_crc32c_func = gfshare_crc32c_sw;
+#ifdef HAVE_SSE42_TARGET
+  __builtin_cpu_init();
+  if( __builtin_cpu_supports( "sse4.2" ) ) {
+    gfshare_crc32c_func = gfshare_crc32c_sse42;
+    return;
+  }
+#endif
+  gfshare_crc32c_build();
+}
+
+#ifdef HAVE_PTHREAD_H
+static pthread_once_t gfshare_crc32c_once = PTHREAD_ONCE_INIT;
+#endif
+
+uint32_t
+gfshare_crc32c( uint32_t crc, const void* data, size_t len )
+{
+#ifdef HAVE_PTHREAD_H
+  pthread_once( &gfshare_crc32c_once, gfshare_crc32c_select );
+#else
+  if( gfshare_crc32c_func == NULL )
+    gfshare_crc32c_select();
+#endif
+  return ~gfshare_crc32c_func( ~crc, data, len );
+}
+
+/* ---------------------------------------------------------[ Headers ]---- */
+
+static void
+put32( unsigned char* p, uint32_t v )
+{
+  p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24;
+}
+
+static uint32_t
+get32( const unsigned char* p )
+{
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+int
+gfshare_file_pwrite( int fd, const void* data, size_t len, off_t offset )
+{
+  const unsigned char *p = data;
+  while( len > 0 ) {
+    ssize_t n = pwrite( fd, p, len, offset );
+    if( n < 0 && errno == EINTR )
+      continue;
+    if( n <= 0 )
+      return 1;
+    p += n;
+    len -= n;
+    offset += n;
+  }
+  return 0;
+}
+
+int
+gfshare_file_pread( int fd, void* data, size_t len, off_t offset )
+{
+  unsigned char *p = data;
+  while( len > 0 ) {
+    ssize_t n = pread( fd, p, len, offset );
+    if( n < 0 && errno == EINTR )
+      continue;
+    if( n < 0 )
+      return 1;
+    if( n == 0 ) {
+      errno = EINVAL;
+      return 1;
+    }
+    p += n;
+    len -= n;
+    offset += n;
+  }
+  return 0;
+}
+
+int
+gfshare_file_write_header( int fd, const gfshare_file_header* header )
+{
+  unsigned char buf[GFSHARE_FILE_HEADER];
+  memset( buf, 0, sizeof(buf) );
+  memcpy( buf, GFSHARE_FILE_MAGIC, sizeof(GFSHARE_FILE_MAGIC) );
+  buf[8] = GFSHARE_FILE_VERSION;
+  buf[9] = header->field;
+  buf[10] = header->sharenr;
+  buf[11] = header->threshold;
+  put32( buf + 12, header->blocksize );
+  put32( buf + 16, (uint32_t)header->length );
+  put32( buf + 20, (uint32_t)(header->length >> 32) );
+  put32( buf + 28, gfshare_crc32c( 0, buf, 28 ) );
+  return gfshare_file_pwrite( fd, buf, sizeof(buf), 0 );
+}
+
+static uint64_t
+gfshare_index_blocks( const gfshare_file_header* header )
+{
+  return (header->length / header->blocksize) +
+         (header->length % header->blocksize != 0);
+}
+
+int
+gfshare_file_read_header( int fd, gfshare_file_header* header )
+{
+  unsigned char buf[GFSHARE_FILE_HEADER];
+  struct stat st;
+  uint64_t room;
+  if( gfshare_file_pread( fd, buf, sizeof(buf), 0 ) )
+    return 1;
+  if( memcmp( buf, GFSHARE_FILE_MAGIC, sizeof(GFSHARE_FILE_MAGIC) ) != 0 ||
+      get32( buf + 28 ) != gfshare_crc32c( 0, buf, 28 ) ) {
+    errno = EINVAL;
+    return 1;
+  }
+  if( buf[8] > GFSHARE_FILE_VERSION ) {
+    errno = ENOTSUP;
+    return 1;
+  }
+  header->field = buf[9];
+  header->sharenr = buf[10];
+  header->threshold = buf[11];
+  header->blocksize = get32( buf + 12 );
+  header->length = get32( buf + 16 ) | ((uint64_t)get32( buf + 20 ) << 32);
+  if( header->field != GFSHARE_FILE_FIELD8 || header->sharenr == 0 ||
+      header->threshold == 0 || header->blocksize == 0 ||
+      header->blocksize > GFSHARE_FILE_BLOCK_MAX ) {
+    errno = EINVAL;
+    return 1;
+  }
+  /* The share and its index must fit in the file, which also keeps every
+   * offset and index size derived from the header from overflowing
+   */
+  if( fstat( fd, &st ) )
+    return 1;
+  room = (uint64_t)st.st_size - GFSHARE_FILE_HEADER;
+  if( header->length > room ||
+      gfshare_index_blocks( header ) >= (room - header->length) / 4 ) {
+    errno = EFBIG;
+    return 1;
+  }
+  return 0;
+}
+
+int
+gfshare_file_is_container( const char* filename )
+{
+  gfshare_file_header header;
+  int fd = open( filename, O_RDONLY );
+  int found;
+  if( fd < 0 )
+    return 0;
+  found = gfshare_file_read_header( fd, &header ) == 0 || errno == EFBIG;
+  close( fd );
+  return found;
+}
+
+/* -----------------------------------------------------------[ Index ]---- */
+
+void
+gfshare_index_init( gfshare_index* index, uint32_t blocksize,
+                    const uint32_t* expect, uint64_t expected )
+{
+  memset( index, 0, sizeof(*index) );
+  index->blocksize = blocksize;
+  index->expect = expect;
+  index->expected = expected;
+  index->bad = -1;
+}
+
+/* The current block is complete */
+static int
+gfshare_index_close( gfshare_index* index )
+{
+  if( index->expect != NULL ) {
+    if( index->bad < 0 && (index->count >= index->expected ||
+                           index->expect[index->count] != index->crc) )
+      index->bad = index->count;
+  } else {
+    if( index->count == index->capacity ) {
+      uint64_t capacity = index->capacity ? index->capacity * 2 : 64;
+      uint32_t *crcs = realloc( index->crcs, capacity * sizeof(uint32_t) );
+      if( crcs == NULL ) {
+        errno = ENOMEM;
+        return 1;
+      }
+      index->crcs = crcs;
+      index->capacity = capacity;
+    }
+    index->crcs[index->count] = index->crc;
+  }
+  index->count++;
+  index->crc = 0;
+  index->filled = 0;
+  return 0;
+}
+
+int
+gfshare_index_update( gfshare_index* index, const void* data, size_t len )
+{
+  const unsigned char *p = data;
+  while( len > 0 ) {
+    size_t n = index->blocksize - index->filled;
+    if( n > len )
+      n = len;
+    index->crc = gfshare_crc32c( index->crc, p, n );
+    index->filled += n;
+    p += n;
+    len -= n;
+    if( index->filled == index->blocksize && gfshare_index_close( index ) )
+      return 1;
+  }
+  return 0;
+}
+
+int
+gfshare_index_finish( gfshare_index* index )
+{
+  if( index->filled > 0 && gfshare_index_close( index ) )
+    return 1;
+  if( index->expect != NULL && index->bad < 0 &&
+      index->count != index->expected )
+    index->bad = index->count;
+  return 0;
+}
+
+int
+gfshare_index_reserve( gfshare_index* index, uint64_t blocks )
+{
+  index->crcs = calloc( blocks ? blocks : 1, sizeof(uint32_t) );
+  if( index->crcs == NULL ) {
+    errno = ENOMEM;
+    return 1;
+  }
+  index->capacity = index->count = blocks;
+  return 0;
+}
+
+void
+gfshare_index_put( gfshare_index* index, uint64_t block,
+                   const void* data, size_t len )
+{
+  index->crcs[block] = gfshare_crc32c( 0, data, len );
+}
+
+int
+gfshare_index_check( const gfshare_index* index, uint64_t block,
+                     const void* data, size_t len )
+{
+  return block >= index->expected ||
+         index->expect[block] != gfshare_crc32c( 0, data, len );
+}
+
+void
+gfshare_index_free( gfshare_index* index )
+{
+  free( index->crcs );
+  index->crcs = NULL;
+}
+
+
+int
+gfshare_file_write_index( int fd, const gfshare_file_header* header,
+                          const gfshare_index* index )
+{
+  uint64_t i, count = gfshare_index_blocks( header );
+  size_t len = (count + 1) * 4;
+  unsigned char *buf;
+  int ret;
+
+  if( index->count != count ) {
+    errno = EINVAL;
+    return 1;
+  }
+  buf = malloc( len );
+  if( buf == NULL ) {
+    errno = ENOMEM;
+    return 1;
+  }
+  for( i = 0; i < count; ++i )
+    put32( buf + (i * 4), index->crcs[i] );
+  put32( buf + (count * 4), gfshare_crc32c( 0, buf, count * 4 ) );
+  ret = gfshare_file_pwrite( fd, buf, len,
+                             GFSHARE_FILE_HEADER + header->length );
+  free( buf );
+  return ret;
+}
+
+int
+gfshare_file_read_index( int fd, const gfshare_file_header* header,
+                         uint32_t** crcs, uint64_t* count )
+{
+  uint64_t i, n = gfshare_index_blocks( header );
+  size_t len = (n + 1) * 4;
+  unsigned char *buf = malloc( len );
+
+  if( buf == NULL ) {
+    errno = ENOMEM;
+    return 1;
+  }
+  if( gfshare_file_pread( fd, buf, len,
+                          GFSHARE_FILE_HEADER + header->length ) ) {
+    free( buf );
+    return 1;
+  }
+  if( get32( buf + (n * 4) ) != gfshare_crc32c( 0, buf, n * 4 ) ) {
+    free( buf );
+    errno = EINVAL;
+    return 1;
+  }
+  *crcs = malloc( (n ? n : 1) * sizeof(uint32_t) );
+  if( *crcs == NULL ) {
+    free( buf );
+    errno = ENOMEM;
+    return 1;
+  }
+  for( i = 0; i < n; ++i )
+    (*crcs)[i] = get32( buf + (i * 4) );
+  *count = n;
+  free( buf );
+  return 0;
+}
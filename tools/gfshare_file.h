@@ -0,0 +1,137 @@
+/*
+ * This file is Copyright the libgfshare contributors 2026
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef GFSHARE_FILE_H
+#define GFSHARE_FILE_H
+
+/* The share container format written by gfsplit -c and read by gfcombine.
+ *
+ * A container is a header, the share itself, and then an index of
+ * CRC32C checksums, one per GFSHARE_FILE_BLOCK bytes of share followed by
+ * one over the index itself. All integers are little-endian:
+ *
+ *   0  magic "gfshare\0"      16  u64 length of the share
+ *   8  u8 format version (1)  24  u32 reserved, zero
+ *   9  u8 field (8)           28  u32 CRC32C of bytes 0 to 27
+ *  10  u8 share number
+ *  11  u8 threshold
+ *  12  u32 bytes per index block
+ *
+ * The share starts at GFSHARE_FILE_HEADER, so offsets into the secret map
+ * directly onto offsets into the file.
+ */
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#define GFSHARE_FILE_HEADER 32
+#define GFSHARE_FILE_VERSION 1
+#define GFSHARE_FILE_FIELD8 8
+#define GFSHARE_FILE_BLOCK (64 * 1024)
+/* The largest index block a reader accepts; gfshare only writes 64KiB */
+#define GFSHARE_FILE_BLOCK_MAX (16 * 1024 * 1024)
+
+typedef struct {
+  unsigned char sharenr;
+  unsigned char threshold;
+  unsigned char field;
+  uint32_t blocksize;
+  uint64_t length;
+} gfshare_file_header;
+
+/* A running checksum of a share, block by block. When writing, each
+ * block's checksum is appended to 'crcs'; when checking, it is compared
+ * with 'expect' and the first mismatch is remembered in 'bad'.
+ */
+typedef struct {
+  uint32_t blocksize;
+  uint32_t crc;           /* of the current block so far */
+  uint32_t filled;        /* bytes of the current block so far */
+  uint64_t count;         /* complete blocks */
+  uint32_t* crcs;
+  uint64_t capacity;
+  const uint32_t* expect; /* NULL when writing */
+  uint64_t expected;      /* how many blocks 'expect' holds */
+  int64_t bad;            /* first block which didn't match, or -1 */
+} gfshare_index;
+
+/* Extend a CRC32C over 'len' more bytes; start from 0 */
+uint32_t gfshare_crc32c(uint32_t /* crc */, const void* /* data */,
+                        size_t /* len */);
+
+/* Write or read and check a header at the start of 'fd'. Reading returns
+ * 1 with errno set to EINVAL if the file is not a container (or its
+ * header is damaged), EFBIG if the header claims a share and index larger
+ * than the file holds, and ENOTSUP if it is from a newer version.
+ */
+int gfshare_file_write_header(int /* fd */, const gfshare_file_header*);
+int gfshare_file_read_header(int /* fd */, gfshare_file_header*);
+
+/* pwrite() or pread() exactly 'len' bytes at 'offset', retrying short
+ * transfers; reading past the end of the file is EINVAL
+ */
+int gfshare_file_pwrite(int /* fd */, const void* /* data */,
+                        size_t /* len */, off_t /* offset */);
+int gfshare_file_pread(int /* fd */, void* /* data */, size_t /* len */,
+                       off_t /* offset */);
+
+/* Whether the named file starts with a container header */
+int gfshare_file_is_container(const char* /* filename */);
+
+/* Start checksumming a share to write, or to check against 'expect' */
+void gfshare_index_init(gfshare_index*, uint32_t /* blocksize */,
+                        const uint32_t* /* expect */,
+                        uint64_t /* expected */);
+/* Checksum the next 'len' bytes of the share; 1 with errno set on
+ * running out of memory
+ */
+int gfshare_index_update(gfshare_index*, const void* /* data */,
+                         size_t /* len */);
+/* Account for the final, partial block */
+int gfshare_index_finish(gfshare_index*);
+void gfshare_index_free(gfshare_index*);
+
+/* Shares handled a block at a time in any order, e.g. by several threads,
+ * use these instead of _update(). Reserving room for all 'blocks' of a
+ * share to write lets each be put in its place as it is done; checking
+ * compares a whole block (the last may be short) with 'expect'. Threads
+ * may put and check different blocks at once.
+ */
+int gfshare_index_reserve(gfshare_index*, uint64_t /* blocks */);
+void gfshare_index_put(gfshare_index*, uint64_t /* block */,
+                       const void* /* data */, size_t /* len */);
+int gfshare_index_check(const gfshare_index*, uint64_t /* block */,
+                        const void* /* data */, size_t /* len */);
+
+/* Write an index after the share described by 'header' in 'fd' */
+int gfshare_file_write_index(int /* fd */, const gfshare_file_header*,
+                             const gfshare_index*);
+/* Read and check the index of the share described by 'header'. On
+ * success '*crcs' is a malloc()ed array of '*count' checksums.
+ */
+int gfshare_file_read_index(int /* fd */, const gfshare_file_header*,
+                            uint32_t** /* crcs */, uint64_t* /* count */);
+
+#endif /* GFSHARE_FILE_H */
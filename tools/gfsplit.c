@@ -9,130 +9,599 @@
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#if defined(HAVE_SYS_MMAN_H) && defined(HAVE_MMAP)
+#include <sys/mman.h>
+#define GFSPLIT_MMAP 1
+#endif
+
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
 
 #include "libgfshare.h"
+#include "gfshare_file.h"
 
 #define DEFAULT_SHARECOUNT 5
 #define DEFAULT_THRESHOLD 3
 #define BUFFER_SIZE 4096
+/* The most of the input mapped and split at once with -M */
+#define MMAP_WINDOW (8 * 1024 * 1024)
+/* Memory for the buffers of a pipelined split's slots, or of a -M window */
+#define PIPELINE_BUDGET (32 * 1024 * 1024)
 
 #ifndef MIN
 #define MIN(a,b) ((a)<(b))?(a):(b)
 #endif
 
-static void
-gfsplit_fill_rand( unsigned char *buffer,
-                   unsigned int count )
-{
-  size_t n;
-  FILE *devrandom;
-
-  devrandom = fopen("/dev/urandom", "rb");
-  if (!devrandom) {
-    perror("Unable to read /dev/urandom");
-    abort();
-  }
-  n = fread(buffer, 1, count, devrandom);
-  if (n < count) {
-      perror("Short read from /dev/urandom");
-      abort();
-  }
-  fclose(devrandom);
-}
-
 static char* progname;
 
 void
 usage(FILE* stream)
 {
   fprintf( stream, "\
-Usage: %s [-n threshold] [-m sharecount] inputfile [outputstem]\n\
+Usage: %s [-n threshold] [-m sharecount] [-M] [-c] inputfile [outputstem]\n\
   where sharecount is the number of shares to build.\n\
   where threshold is the number of shares needed to recombine.\n\
-  where inputfile is the file to split.\n\
+  where -M memory-maps the input instead of reading it through stdio.\n\
+  where -c writes each share in a container with its share number,\n\
+    threshold, length and block checksums (see gfshare(7)).\n\
+  where inputfile is the file to split, or - for standard input.\n\
   where outputstem is the stem for the output files.\n\
 \n\
 The sharecount option defaults to %d.\n\
 The threshold option defaults to %d.\n\
-The outputstem option defaults to the inputfile.\n\
+The outputstem option defaults to the inputfile, and must be given when\n\
+splitting standard input (or any other stream) as it arrives.\n\
 \n\
 The program automatically adds \".NNN\" to the output stem for each share.\n\
 ", progname, DEFAULT_SHARECOUNT, DEFAULT_THRESHOLD );
 }
 
+/* Choose distinct, non-zero share numbers at random */
+static void
+pick_sharenrs( unsigned char* sharenrs, unsigned int sharecount )
+{
+  unsigned int i, j;
+  for( i = 0; i < sharecount; ++i ) {
+    unsigned char proposed = (random() & 0xff00) >> 8;
+    if( proposed == 0 ) {
+      proposed = 1;
+    }
+    SHARENR_TRY_AGAIN:
+    for( j = 0; j < i; ++j ) {
+      if( sharenrs[j] == proposed ) {
+        proposed++;
+        if( proposed == 0 ) proposed = 1;
+        goto SHARENR_TRY_AGAIN;
+      }
+    }
+    sharenrs[i] = proposed;
+  }
+}
+
+/* Split the input a block at a time, strictly reading, computing and then
+ * writing each block in turn
+ */
+static int
+split_serial( gfshare_ctx *G, FILE *inputfile,
+              FILE **outputfiles, char **outputfilenames,
+              gfshare_index *indexes,
+              unsigned int sharecount, unsigned int blocksize )
+{
+  unsigned int i;
+  unsigned char* buffer = malloc( blocksize );
+  unsigned char** sharebuffers = malloc( sizeof(unsigned char*) * sharecount );
+
+  if( buffer == NULL || sharebuffers == NULL ) {
+    perror( "malloc" );
+    return 1;
+  }
+  for( i = 0; i < sharecount; ++i ) {
+    sharebuffers[i] = malloc( blocksize );
+    if( sharebuffers[i] == NULL ) {
+      perror( "malloc" );
+      return 1;
+    }
+  }
+  while( !feof(inputfile) ) {
+    unsigned int bytes_read = fread( buffer, 1, blocksize, inputfile );
+    if( bytes_read == 0 ) break;
+    if( bytes_read < blocksize )
+      gfshare_ctx_setsize( G, bytes_read );
+    gfshare_ctx_enc_setsecret_nocopy( G, buffer );
+    gfshare_ctx_enc_getshares( G, sharebuffers );
+    for( i = 0; i < sharecount; ++i ) {
+      unsigned int bytes_written;
+      if( indexes != NULL &&
+          gfshare_index_update( &indexes[i], sharebuffers[i], bytes_read ) ) {
+        perror( "malloc" );
+        return 1;
+      }
+      bytes_written = fwrite( sharebuffers[i], 1, bytes_read, outputfiles[i] );
+      if( bytes_read != bytes_written || fflush( outputfiles[i] ) != 0 ) {
+        perror(outputfilenames[i]);
+        return 1;
+      }
+    }
+  }
+  return 0;
+}
+
+#ifdef HAVE_PTHREAD_H
+/* The pipelined splitter: a reader thread fills blocks, the main thread
+ * computes their shares, and a writer thread per share file writes them
+ * out. Computing block N thus overlaps reading block N+1 and writing
+ * block N-1, and each share file is written as fast as its own disk
+ * allows, so a run takes about as long as its slowest device rather than
+ * the sum of them all.
+ */
+#define PIPELINE_SLOTS 3
+/* The most any one block gets */
+#define PIPELINE_BLOCK_MAX (1024 * 1024)
+
+typedef struct {
+  unsigned char* input;
+  unsigned char** shares;
+  unsigned int length;
+} gfsplit_slot;
+
+typedef struct {
+  pthread_mutex_t lock;
+  pthread_cond_t changed;
+  gfsplit_slot slots[PIPELINE_SLOTS];
+  unsigned int blocksize;
+  unsigned int sharecount;
+  unsigned long nread;      /* blocks read so far */
+  unsigned long ncomputed;  /* blocks whose shares are ready */
+  unsigned long *nwritten;  /* blocks written, per share file */
+  int eof;                  /* nothing more to read */
+  int done;                 /* nothing more to compute */
+  int failed;
+  FILE *inputfile;
+  FILE **outputfiles;
+  char **outputfilenames;
+  gfshare_index *indexes;   /* per share file, when writing containers */
+} gfsplit_pipeline;
+
+typedef struct {
+  gfsplit_pipeline *p;
+  unsigned int share;
+} gfsplit_writer;
+
 static unsigned int
-getlen( FILE* f )
+pipeline_blocksize( unsigned int sharecount )
 {
-  unsigned int len;
-  fseek(f, 0, SEEK_END);
-  len = ftell(f);
-  fseek(f, 0, SEEK_SET);
-  return len;
+  unsigned int size = PIPELINE_BUDGET / (PIPELINE_SLOTS * (sharecount + 1));
+  size &= ~(BUFFER_SIZE - 1);
+  if( size < BUFFER_SIZE ) return BUFFER_SIZE;
+  if( size > PIPELINE_BLOCK_MAX ) return PIPELINE_BLOCK_MAX;
+  return size;
+}
+
+static void*
+pipeline_reader( void* arg )
+{
+  gfsplit_pipeline *p = arg;
+  unsigned long block, oldest;
+  unsigned int i;
+
+  for( block = 0; ; ++block ) {
+    gfsplit_slot *slot = &p->slots[block % PIPELINE_SLOTS];
+    /* Wait for every writer to finish with the slot's last block */
+    pthread_mutex_lock( &p->lock );
+    for( ;; ) {
+      oldest = block;
+      for( i = 0; i < p->sharecount; ++i )
+        if( p->nwritten[i] < oldest ) oldest = p->nwritten[i];
+      if( p->failed || block - oldest < PIPELINE_SLOTS ) break;
+      pthread_cond_wait( &p->changed, &p->lock );
+    }
+    if( p->failed ) {
+      pthread_mutex_unlock( &p->lock );
+      return NULL;
+    }
+    pthread_mutex_unlock( &p->lock );
+
+    slot->length = fread( slot->input, 1, p->blocksize, p->inputfile );
+
+    pthread_mutex_lock( &p->lock );
+    if( ferror(p->inputfile) ) {
+      perror( "read" );
+      p->failed = 1;
+    } else if( slot->length == 0 ) {
+      p->eof = 1;
+    } else {
+      p->nread = block + 1;
+    }
+    pthread_cond_broadcast( &p->changed );
+    if( p->failed || p->eof ) {
+      pthread_mutex_unlock( &p->lock );
+      return NULL;
+    }
+    pthread_mutex_unlock( &p->lock );
+  }
+}
+
+static void*
+pipeline_writer( void* arg )
+{
+  gfsplit_writer *w = arg;
+  gfsplit_pipeline *p = w->p;
+  unsigned long block;
+
+  for( block = 0; ; ++block ) {
+    gfsplit_slot *slot = &p->slots[block % PIPELINE_SLOTS];
+    unsigned int bytes_written;
+    pthread_mutex_lock( &p->lock );
+    while( !p->failed && !p->done && block >= p->ncomputed )
+      pthread_cond_wait( &p->changed, &p->lock );
+    if( p->failed || block >= p->ncomputed ) {
+      pthread_mutex_unlock( &p->lock );
+      return NULL;
+    }
+    pthread_mutex_unlock( &p->lock );
+
+    /* Checksum the block as it goes out, while it is still in cache */
+    if( p->indexes != NULL &&
+        gfshare_index_update( &p->indexes[w->share],
+                              slot->shares[w->share], slot->length ) )
+      bytes_written = 0;
+    else
+      bytes_written = fwrite( slot->shares[w->share], 1, slot->length,
+                              p->outputfiles[w->share] );
+
+    pthread_mutex_lock( &p->lock );
+    if( bytes_written != slot->length ||
+        fflush( p->outputfiles[w->share] ) != 0 ) {
+      perror( p->outputfilenames[w->share] );
+      p->failed = 1;
+    }
+    p->nwritten[w->share] = block + 1;
+    pthread_cond_broadcast( &p->changed );
+    pthread_mutex_unlock( &p->lock );
+  }
+}
+
+static int
+split_pipelined( gfshare_ctx *G, FILE *inputfile,
+                 FILE **outputfiles, char **outputfilenames,
+                 gfshare_index *indexes,
+                 unsigned int sharecount, unsigned int blocksize )
+{
+  gfsplit_pipeline p;
+  gfsplit_writer *writers = malloc( sizeof(gfsplit_writer) * sharecount );
+  pthread_t *threads = malloc( sizeof(pthread_t) * (sharecount + 1) );
+  unsigned long block;
+  unsigned int i, j, started = 0;
+
+  memset( &p, 0, sizeof(p) );
+  p.nwritten = calloc( sharecount, sizeof(unsigned long) );
+  if( writers == NULL || threads == NULL || p.nwritten == NULL ) {
+    perror( "malloc" );
+    return 1;
+  }
+  for( i = 0; i < PIPELINE_SLOTS; ++i ) {
+    p.slots[i].input = malloc( blocksize );
+    p.slots[i].shares = malloc( sizeof(unsigned char*) * sharecount );
+    if( p.slots[i].input == NULL || p.slots[i].shares == NULL ) {
+      perror( "malloc" );
+      return 1;
+    }
+    for( j = 0; j < sharecount; ++j ) {
+      p.slots[i].shares[j] = malloc( blocksize );
+      if( p.slots[i].shares[j] == NULL ) {
+        perror( "malloc" );
+        return 1;
+      }
+    }
+  }
+  pthread_mutex_init( &p.lock, NULL );
+  pthread_cond_init( &p.changed, NULL );
+  p.blocksize = blocksize;
+  p.sharecount = sharecount;
+  p.inputfile = inputfile;
+  p.outputfiles = outputfiles;
+  p.outputfilenames = outputfilenames;
+  p.indexes = indexes;
+
+  if( pthread_create( &threads[0], NULL, pipeline_reader, &p ) != 0 )
+    p.failed = 1;
+  else
+    started = 1;
+  /* The reader is already running, so p.failed is only read under the
+   * lock; stop at the first thread that can't be started instead */
+  for( i = 0; i < sharecount && started; ++i ) {
+    writers[i].p = &p;
+    writers[i].share = i;
+    if( pthread_create( &threads[i + 1], NULL, pipeline_writer,
+                        &writers[i] ) != 0 ) {
+      pthread_mutex_lock( &p.lock );
+      p.failed = 1;
+      pthread_cond_broadcast( &p.changed );
+      pthread_mutex_unlock( &p.lock );
+      break;
+    }
+    started = i + 2;
+  }
+
+  for( block = 0; ; ++block ) {
+    gfsplit_slot *slot = &p.slots[block % PIPELINE_SLOTS];
+    pthread_mutex_lock( &p.lock );
+    while( !p.failed && !p.eof && block >= p.nread )
+      pthread_cond_wait( &p.changed, &p.lock );
+    if( p.failed || block >= p.nread ) {
+      p.done = 1;
+      pthread_cond_broadcast( &p.changed );
+      pthread_mutex_unlock( &p.lock );
+      break;
+    }
+    pthread_mutex_unlock( &p.lock );
+
+    /* Only the last block of the input can be short */
+    if( slot->length < blocksize )
+      gfshare_ctx_setsize( G, slot->length );
+    gfshare_ctx_enc_setsecret_nocopy( G, slot->input );
+    gfshare_ctx_enc_getshares( G, slot->shares );
+
+    pthread_mutex_lock( &p.lock );
+    p.ncomputed = block + 1;
+    pthread_cond_broadcast( &p.changed );
+    pthread_mutex_unlock( &p.lock );
+  }
+
+  for( i = 0; i < started; ++i )
+    pthread_join( threads[i], NULL );
+  if( p.failed && started < sharecount + 1 )
+    fprintf( stderr, "%s: Unable to start the I/O threads\n", progname );
+  pthread_cond_destroy( &p.changed );
+  pthread_mutex_destroy( &p.lock );
+  return p.failed;
+}
+#endif
+
+/* Start checksumming each share, for a container around it */
+static gfshare_index*
+start_containers( unsigned int sharecount )
+{
+  gfshare_index *indexes = malloc( sizeof(gfshare_index) * sharecount );
+  unsigned int i;
+  if( indexes == NULL ) {
+    perror( "malloc" );
+    return NULL;
+  }
+  for( i = 0; i < sharecount; ++i )
+    gfshare_index_init( &indexes[i], GFSHARE_FILE_BLOCK, NULL, 0 );
+  return indexes;
+}
+
+/* Close off a container once its share has been written: the index goes
+ * after the share, and then the header, now the length is known, before
+ * it. Until then the file is not recognisable as a container.
+ */
+static int
+finish_container( int fd, unsigned char sharenr, unsigned int threshold,
+                  gfshare_index *index )
+{
+  gfshare_file_header header;
+  header.sharenr = sharenr;
+  header.threshold = threshold;
+  header.field = GFSHARE_FILE_FIELD8;
+  header.blocksize = index->blocksize;
+  header.length = (index->count * index->blocksize) + index->filled;
+  if( gfshare_index_finish( index ) ||
+      gfshare_file_write_index( fd, &header, index ) ||
+      gfshare_file_write_header( fd, &header ) )
+    return 1;
+  gfshare_index_free( index );
+  return 0;
 }
 
 static int
 do_gfsplit( unsigned int sharecount, 
             unsigned int threshold,
             char *_inputfile,
-            char *_outputstem )
+            char *_outputstem,
+            int container )
 {
   FILE *inputfile;
   unsigned char* sharenrs = malloc( sharecount );
-  unsigned int i, j;
+  unsigned int i, len, blocksize = BUFFER_SIZE;
+  int failed;
+  struct stat st;
   FILE **outputfiles = malloc( sizeof(FILE*) * sharecount );
   char **outputfilenames = malloc( sizeof(char*) * sharecount );
   char* outputfilebuffer = malloc( strlen(_outputstem) + 5 );
-  unsigned char* buffer = malloc( BUFFER_SIZE );
+  gfshare_index *indexes = NULL;
   gfshare_ctx *G;
   
-  if( sharenrs == NULL || outputfiles == NULL || outputfilenames == NULL || outputfilebuffer == NULL || buffer == NULL ) {
+  if( sharenrs == NULL || outputfiles == NULL || outputfilenames == NULL || outputfilebuffer == NULL ) {
     perror( "malloc" );
     return 1;
   }
+  if( container && (indexes = start_containers( sharecount )) == NULL )
+    return 1;
+#ifdef HAVE_PTHREAD_H
+  blocksize = pipeline_blocksize( sharecount );
+#endif
+  len = blocksize;
   
-  inputfile = fopen( _inputfile, "rb" );
+  if( strcmp( _inputfile, "-" ) == 0 )
+    inputfile = stdin;
+  else
+    inputfile = fopen( _inputfile, "rb" );
   if( inputfile == NULL ) {
     perror( _inputfile );
     return 1;
   }
+  /* Only a regular file says how long it is; anything else (a pipe, say)
+   * is streamed through contexts and buffers sized by the block alone.
+   */
+  if( fstat( fileno(inputfile), &st ) != 0 || !S_ISREG(st.st_mode) )
+    st.st_size = -1;
+  else if( st.st_size < blocksize )
+    len = (st.st_size > 0) ? st.st_size : 1;
+  pick_sharenrs( sharenrs, sharecount );
   for( i = 0; i < sharecount; ++i ) {
-    unsigned char proposed = (random() & 0xff00) >> 8;
-    if( proposed == 0 ) {
-      proposed = 1;
-    }
-    SHARENR_TRY_AGAIN:
-    for( j = 0; j < i; ++j ) {
-      if( sharenrs[j] == proposed ) {
-        proposed++;
-        if( proposed == 0 ) proposed = 1;
-        goto SHARENR_TRY_AGAIN;
-      }
-    }
-    sharenrs[i] = proposed;
-    sprintf( outputfilebuffer, "%s.%03d", _outputstem, proposed );
+    sprintf( outputfilebuffer, "%s.%03d", _outputstem, sharenrs[i] );
     outputfiles[i] = fopen( outputfilebuffer, "wb" );
-    if( outputfiles[i] == NULL ) {
+    /* The header is filled in once the share is complete */
+    if( outputfiles[i] == NULL ||
+        (container && fseek( outputfiles[i], GFSHARE_FILE_HEADER,
+                             SEEK_SET ) != 0) ) {
       perror(outputfilebuffer);
       return 1;
     }
     outputfilenames[i] = strdup(outputfilebuffer);
   }
   /* All open, all ready and raring to go... */
-  G = gfshare_ctx_init_enc( sharenrs, sharecount, 
-                            threshold, MIN(BUFFER_SIZE, getlen( inputfile )) );
+  G = gfshare_ctx_init_enc( sharenrs, sharecount, threshold, len );
   if( !G ) {
     perror("gfshare_ctx_init_enc");
     return 1;
   }
-  while( !feof(inputfile) ) {
-    unsigned int bytes_read = fread( buffer, 1, BUFFER_SIZE, inputfile );
-    if( bytes_read == 0 ) break;
-    gfshare_ctx_enc_setsecret( G, buffer );
+#ifdef HAVE_PTHREAD_H
+  /* A single block has nothing to overlap with */
+  if( st.st_size < 0 || st.st_size > blocksize )
+    failed = split_pipelined( G, inputfile, outputfiles, outputfilenames,
+                              indexes, sharecount, blocksize );
+  else
+#endif
+    failed = split_serial( G, inputfile, outputfiles, outputfilenames,
+                           indexes, sharecount, len );
+  gfshare_ctx_free( G );
+  if( failed )
+    return 1;
+  fclose(inputfile);
+  for( i = 0; i < sharecount; ++i ) {
+    if( container &&
+        (fflush(outputfiles[i]) != 0 ||
+         finish_container( fileno(outputfiles[i]), sharenrs[i], threshold,
+                           &indexes[i] )) ) {
+      perror(outputfilenames[i]);
+      return 1;
+    }
+    if( fclose(outputfiles[i]) != 0 ) {
+      perror(outputfilenames[i]);
+      return 1;
+    }
+  }
+  return 0;
+}
+
+#ifdef GFSPLIT_MMAP
+/* Each window needs a buffer per share and the encoder's rows, so size it
+ * from the same budget as the pipeline, in whole pages for mmap()
+ */
+static unsigned int
+mmap_window( unsigned int sharecount, unsigned int threshold, off_t filesize )
+{
+  unsigned int page = sysconf( _SC_PAGESIZE );
+  unsigned int size = PIPELINE_BUDGET / (sharecount + threshold);
+  size -= size % page;
+  if( size < page ) size = page;
+  if( size > MMAP_WINDOW ) size = MMAP_WINDOW;
+  if( filesize < size ) size = filesize;
+  return size ? size : 1;
+}
+
+/* Split a regular file a window at a time, straight out of a mapping of
+ * the input, writing each share of the window with a single pwrite().
+ */
+static int
+do_gfsplit_mmap( unsigned int sharecount,
+                 unsigned int threshold,
+                 char *_inputfile,
+                 char *_outputstem,
+                 int container )
+{
+  int inputfd;
+  struct stat st;
+  off_t offset;
+  unsigned char* sharenrs = malloc( sharecount );
+  unsigned int i, window;
+  int *outputfds = malloc( sizeof(int) * sharecount );
+  char **outputfilenames = malloc( sizeof(char*) * sharecount );
+  char* outputfilebuffer = malloc( strlen(_outputstem) + 5 );
+  unsigned char** sharebuffers = malloc( sizeof(unsigned char*) * sharecount );
+  gfshare_index *indexes = NULL;
+  off_t base = container ? GFSHARE_FILE_HEADER : 0;
+  gfshare_ctx *G;
+
+  if( sharenrs == NULL || outputfds == NULL || outputfilenames == NULL || outputfilebuffer == NULL || sharebuffers == NULL ) {
+    perror( "malloc" );
+    return 1;
+  }
+  if( container && (indexes = start_containers( sharecount )) == NULL )
+    return 1;
+
+  inputfd = open( _inputfile, O_RDONLY );
+  if( inputfd < 0 || fstat( inputfd, &st ) != 0 ) {
+    perror( _inputfile );
+    return 1;
+  }
+  if( !S_ISREG(st.st_mode) ) {
+    fprintf( stderr, "%s: %s: -M needs a regular file\n", progname, _inputfile );
+    return 1;
+  }
+  window = mmap_window( sharecount, threshold, st.st_size );
+  for( i = 0; i < sharecount; ++i ) {
+    sharebuffers[i] = malloc( window );
+    if( sharebuffers[i] == NULL ) {
+      perror( "malloc" );
+      return 1;
+    }
+  }
+
+  pick_sharenrs( sharenrs, sharecount );
+  for( i = 0; i < sharecount; ++i ) {
+    sprintf( outputfilebuffer, "%s.%03d", _outputstem, sharenrs[i] );
+    outputfds[i] = open( outputfilebuffer, O_WRONLY | O_CREAT | O_TRUNC, 0666 );
+    if( outputfds[i] < 0 ) {
+      perror(outputfilebuffer);
+      return 1;
+    }
+    outputfilenames[i] = strdup(outputfilebuffer);
+  }
+
+  G = gfshare_ctx_init_enc( sharenrs, sharecount, threshold, window );
+  if( !G ) {
+    perror("gfshare_ctx_init_enc");
+    return 1;
+  }
+  /* Windows are big enough to be worth sharing between the CPUs */
+  gfshare_ctx_set_threads( G, 0 );
+  for( offset = 0; offset < st.st_size; offset += window ) {
+    unsigned int len = window;
+    unsigned char* input;
+    if( st.st_size - offset < window ) {
+      len = st.st_size - offset;
+      gfshare_ctx_setsize( G, len );
+    }
+    input = mmap( NULL, len, PROT_READ, MAP_SHARED, inputfd, offset );
+    if( input == MAP_FAILED ) {
+      perror( _inputfile );
+      gfshare_ctx_free( G );
+      return 1;
+    }
+#ifdef HAVE_MADVISE
+    madvise( input, len, MADV_SEQUENTIAL );
+#endif
+    gfshare_ctx_enc_setsecret_nocopy( G, input );
+    gfshare_ctx_enc_getshares( G, sharebuffers );
+    munmap( input, len );
     for( i = 0; i < sharecount; ++i ) {
-      unsigned int bytes_written;
-      gfshare_ctx_enc_getshare( G, i, buffer );
-      bytes_written = fwrite( buffer, 1, bytes_read, outputfiles[i] );
-      if( bytes_read != bytes_written ) {
+      if( indexes != NULL &&
+          gfshare_index_update( &indexes[i], sharebuffers[i], len ) ) {
+        perror( "malloc" );
+        gfshare_ctx_free( G );
+        return 1;
+      }
+      if( pwrite( outputfds[i], sharebuffers[i], len,
+                  base + offset ) != (ssize_t)len ) {
         perror(outputfilenames[i]);
         gfshare_ctx_free( G );
         return 1;
@@ -140,14 +609,24 @@ do_gfsplit( unsigned int sharecount,
     }
   }
   gfshare_ctx_free( G );
-  fclose(inputfile);
+  close(inputfd);
   for( i = 0; i < sharecount; ++i ) {
-    fclose(outputfiles[i]);
+    if( container &&
+        finish_container( outputfds[i], sharenrs[i], threshold,
+                          &indexes[i] ) ) {
+      perror(outputfilenames[i]);
+      return 1;
+    }
+    if( close(outputfds[i]) != 0 ) {
+      perror(outputfilenames[i]);
+      return 1;
+    }
   }
   return 0;
 }
+#endif
 
-#define OPTSTRING "n:m:hv"
+#define OPTSTRING "n:m:Mchv"
 int
 main( int argc, char **argv )
 {
@@ -156,18 +635,13 @@ main( int argc, char **argv )
   char *inputfile;
   char *outputstem;
   char *endptr;
-  int optnr;
+  int optnr, container = 0;
+#ifdef GFSPLIT_MMAP
+  int use_mmap = 0;
+#endif
   
   progname = argv[0];
   srandom( time(NULL) );
-
-  if (access("/dev/urandom", R_OK) == 0) {
-    gfshare_fill_rand = gfsplit_fill_rand;
-  } else {
-    fprintf(stderr, "\
-%s: Cannot access /dev/urandom, so using rand() instead (not secure!)\n\
-", progname);
-  }
   
   while( (optnr = getopt(argc, argv, OPTSTRING)) != -1 ) {
     switch( optnr ) {
@@ -196,6 +670,17 @@ warranty; not even for MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.\n\
         return 1;
       }
       break;
+    case 'M':
+#ifdef GFSPLIT_MMAP
+      use_mmap = 1;
+#else
+      fprintf( stderr, "%s: -M is not supported on this system\n", progname );
+      return 1;
+#endif
+      break;
+    case 'c':
+      container = 1;
+      break;
     case 'n':
       threshold = strtoul( optarg, &endptr, 10 );
       if( *endptr != 0 || *optarg == 0 || 
@@ -213,6 +698,21 @@ warranty; not even for MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.\n\
     return 1;
   }
   inputfile = argv[optind++];
+  if( strcmp( inputfile, "-" ) == 0 && argc == optind ) {
+    fprintf( stderr, "%s: An outputstem is needed to split standard input\n", progname );
+    usage( stderr );
+    return 1;
+  }
   outputstem = (argc == optind)?inputfile:argv[optind++];
-  return do_gfsplit( sharecount, threshold, inputfile, outputstem );
+#ifdef GFSPLIT_MMAP
+  if( use_mmap && strcmp( inputfile, "-" ) == 0 ) {
+    fprintf( stderr, "%s: -M needs a regular file, not standard input\n", progname );
+    return 1;
+  }
+  if( use_mmap )
+    return do_gfsplit_mmap( sharecount, threshold, inputfile, outputstem,
+                            container );
+#endif
+  return do_gfsplit( sharecount, threshold, inputfile, outputstem,
+                     container );
 }